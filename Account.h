@@ -1,257 +1,334 @@
-#ifndef ACCOUNT_H_
-#define ACCOUNT_H_
-#include <string>
-#include <vector>
-#include <sstream>
-#include "Customer.h"
-#include "Transaction.h"
-
-
-/**
-The Bank has Accounts and an Account belongs to a Customer.
-Additionally, there are specialized types of accounts: Checking_Account and Savings_Account.
-Checking_Account and Savings_Account have specialized ways of adding interest, and describing itself.
-
-@author: Ed Walker
-*/
-
-//Prototypes for the classes defined later in this header file
-class Savings_Account;
-class Checking_Account;
-
-class Account {
-protected:
-	Customer *customer;		// The customer who owns this account
-	double balance;			// The available balance in this account
-	int account_number;		// A unique number identifying this account
-	std::vector<Transaction *> transactions;  // The record of transactions that have occured with this account
-
-	/**
-	Describe fees associated with the customer who owns this account.
-	The fee will depend on the specific type of customer.
-	@return string showing checking and overdraft fees
-	*/
-	std::string get_fees()
-	{
-		int overdraft, charge;
-    
-        // Polymorphism: calls the correct virtual methods from the specific customer type
-        // Get the overdraft and check charge information from this accounts customer
-        overdraft = customer->get_overdraft_penalty();
-        charge = customer->get_check_charge();
-        
-        //Store this information in a string and output it
-		std::stringstream ss;
-		ss << "Check Charge: " << charge << " Overdraft Fee: " << overdraft;
-		return ss.str();
-	}
-
-protected:
-	/**
-	Add interest based on a specified interest rate to account
-	@param interest	The interest rate
-	*/
-	void add_interest(double interest) {
-        //Calculate the amount after adding interest
-		double amt = balance*interest;
-		balance = balance + amt;
-        //Define the transaction type
-        std::string type = "Add interest";
-        //Get the customer's fees
-		std::string fees = get_fees();
-        //Get the customer's ID number
-        int cust_id = customer->get_customer_id();
-        
-        //Create a Transaction object and assign it to the transaction vector
-		Transaction *tran = NULL;
-        tran = new Transaction(cust_id,type, amt, fees);
-		transactions.push_back(tran);
-	}
-
-public:
-	/**
-	Constructor requires a customer to create an account
-	Balance always starts with 0 when account is created.
-	*/
-	Account(Customer *cust, int id) : customer(cust), account_number(id), balance(0) {}
-
-	/**
-	Generic accesser and setter methods for properties customer, balance, and account_number
-	*/
-
-	Customer *get_customer() {
-		return customer;
-	}
-
-	void set_customer(Customer *cust) {
-		customer = cust;
-	}
-
-	int get_account() {
-		return account_number;
-	}
-
-	void set_balance(double new_balance) {
-		balance = new_balance;
-	}
-
-	void set_account(int account_number) {
-		this->account_number = account_number;
-	}
-
-	double get_balance() {
-		return balance;
-	}
-
-	/**
-	Generic method describing the account information.
-
-	Remember that you will need to indicate if an account is Savings or Checking in 
-	an overridden version of to_string() in the derived classes. 
-
-	@return string describing generic information about the account
-	*/
-    
-    //Function prototype that is defined later in the class
-    virtual std::string to_string();
-
-	/**
-	Deposits amount into account
-	@param amt The deposit amount
-	*/
-	virtual void deposit(double amt) {
-        //Calculate the deposit amount
-		balance += amt;
-        //Get the customer's fees
-		std::string fees = get_fees();
-        //Define transaction type
-        string type = "Deposit";
-        //Get customer's ID
-        int cust_id = customer->get_customer_id();
-        
-        //Create a Transaction object and assign it to transaction vector
-		Transaction *tran = NULL;
-        tran = new Transaction(cust_id,type, amt, fees);
-		transactions.push_back(tran);
-	}
-
-	/**
-	Withdraws amount from account
-	@param amt The withdrawal amount
-	*/
-	virtual void withdraw(double amt) {
-        //Calculate the withdrawal amount
-		balance -= amt;
-        //Get customer's fees
-		std::string fees = get_fees();
-        //Define transaction type
-        string type = "Withdrawal";
-        //Get customer's ID
-        int cust_id = customer->get_customer_id();
-        
-        // Create a Transaction object and assign it to tran
-		Transaction *tran = NULL;
-        tran = new Transaction(cust_id, type, amt, fees);
-		transactions.push_back(tran);
-	}
-
-	// Savings_Account and Checking_Account implement this
-	virtual void add_interest() = 0;
-
-};
-
-//Savings_Account IS-A Account
-class Savings_Account: public Account{
-
-public:
-    //Constructor for Savings_Account
-    Savings_Account(Customer *cust, int id) : Account(cust, id) {};
-    //Function to calculate balance after deposit
-    void deposit(double amt)
-    {
-        balance += amt;
-    }
-    //Function to calculate balance after withdrawal
-    void withdraw(double amt)
-    {
-        balance -= amt;
-    }
-    //Function to calculate balance after interest
-    void add_interest()
-    {
-        double sav_interest = customer->get_savings_interest();
-        double interest = balance * sav_interest;
-        balance += interest;
-        
-    }
-    //Define account type in the to_string function
-    string to_string(){
-        std::stringstream ss;
-        
-        ss << "Account type: Savings" << std::endl;
-        return ss.str();
-    }
-};
-
-//Checking_Account IS-A Account
-class Checking_Account: public Account{
-    
-public:
-    //Constructor for Checking_Account
-    Checking_Account(Customer *cust, int id) : Account(cust, id) {};
-    //Function to calculate blance after deposit
-    void deposit(double amt)
-    {
-        balance += amt;
-    }
-    //Function to calculate balance after withdrawal
-    void withdraw(double amt)
-    {
-        balance -= amt;
-    }
-    //Function to calculate balance after interest
-    void add_interest()
-    {
-        double check_interest = customer->get_check_interest();
-        double interest = balance * check_interest;
-        balance += interest;
-    }
-    //Define account type in the to_string function
-    string to_string(){
-        std::stringstream ss;
-        
-        ss << "Account type: Checking" << std::endl;
-        return ss.str();
-    }
-};
-
-std::string Account::to_string() {
-    std::stringstream ss; // for composing the string that describes this account
-    
-    //Add information about the customer who owns this account
-    
-    ss << "  Name: " << customer->get_name() << std::endl;
-    ss << "  Customer ID number: " << customer->get_customer_id() << std:: endl;
-    ss << "  Address: " << customer->get_address() << std:: endl;
-    ss << "  Phone number: " << customer->get_telephone_number() << std:: endl;
-    ss << "  Age: " << customer->get_age() << std:: endl;
-    ss << "  Customer type: " << customer->get_cust_type() << std:: endl;
-    ss << "  Balance: " << balance << std::endl;
-    ss << "  Account ID: " << account_number << std::endl;
-    ss << "  Savings interest: " << customer->get_savings_interest() << std::endl;
-    ss << "  Checking interest: " << customer->get_check_interest() << std::endl;
-    ss << "  Check charge: " << customer->get_check_charge() << std::endl;
-    ss << "  Overdraft fee: " << customer->get_overdraft_penalty() << std::endl;
-    //Returns the correct account type depending on the account 
-    if (typeid(Savings_Account) == typeid(*this))
-    {
-        dynamic_cast<Savings_Account*>(this)->to_string();
-    }
-    else if(typeid(Checking_Account) == typeid(*this))
-    {
-        dynamic_cast<Checking_Account*>(this)->to_string();
-    }
-    return ss.str();
-}
-
-#endif
+#ifndef ACCOUNT_H_
+#define ACCOUNT_H_
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sstream>
+#include "Account_Store.h"
+#include "Customer.h"
+#include "Journal.h"
+#include "Transaction.h"
+
+/**
+@return true if every tier's check charge and overdraft penalty fits the 16-bit fee fields of a Transaction
+*/
+constexpr bool fees_fit_transactions()
+{
+	for (const Fee_Schedule &schedule : TIER_SCHEDULES) {
+		if (schedule.check_charge.get_cents() < 0 || schedule.check_charge.get_cents() > Transaction::MAX_FEE_CENTS
+				|| schedule.overdraft_penalty.get_cents() < 0 || schedule.overdraft_penalty.get_cents() > Transaction::MAX_FEE_CENTS)
+			return false;
+	}
+	return true;
+}
+
+static_assert(fees_fit_transactions(), "a tier fee is too large for the fee fields of a Transaction record");
+
+/**
+The Bank has Accounts and an Account belongs to a Customer.
+Additionally, there are specialized types of accounts: Checking_Account and Savings_Account.
+Checking_Account and Savings_Account have specialized ways of adding interest, and describing itself.
+
+@author: Ed Walker
+*/
+
+//Prototypes for the classes defined later in this header file
+class Savings_Account;
+class Checking_Account;
+
+class Account {
+	// The bank's bulk operations (e.g. interest runs) update the balance column directly and only need to record
+	friend class Bank;
+	// Sharded_Bank workers post both legs of a transfer on separate threads
+	friend class Sharded_Bank;
+
+protected:
+	// The fields a posting touches are kept together at the front
+	Money *balance;		// The available balance in this account: a slot in the bank's Account_Store, or local_balance
+	const Fee_Schedule *schedule;	// Interest rates and fees of the customer's tier, looked up once
+	Transaction_Log transactions;  // The record of transactions that have occured with this account, owned by the account
+	Journal *journal;		// Where postings are also written durably, NULL if nowhere; owned by whoever set it
+	int account_number;		// A unique number identifying this account
+	int customer_number;	// The owner's customer id, kept here so recording a posting need not visit the customer
+	Account_Type type;		// Savings or checking
+	Customer *customer;		// The customer who owns this account
+	Money local_balance;	// Holds the balance while the account is not attached to a store
+	Account_Store *store;	// The store holding this account's row, NULL if none
+	size_t row;				// This account's row in store
+
+	/**
+	Append a record of a posting to this account's log, along with the customer's current fees
+	@param type	The kind of transaction
+	@param amt	The amount of the transaction
+	@param when	Time of the posting; a withdrawal and its fees share one
+	*/
+	void record(Transaction_Type type, Money amt, int64_t when)
+	{
+		Transaction tran(customer_number, type, amt, schedule->check_charge, schedule->overdraft_penalty, 0, when);
+		transactions.append(tran);
+		if (journal)
+			journal->append(account_number, tran);
+	}
+
+	/**
+	Move money in or out of this account as one leg of a transfer, and record it.
+	Used by Bank::transfer, which has already checked the funds and holds the locks.
+	@param type			Transfer_Out or Transfer_In
+	@param amt			The amount transferred
+	@param counterparty	The account on the other side
+	@param when			Time of the transfer, shared by both legs
+	*/
+	void post_transfer(Transaction_Type type, Money amt, int counterparty, int64_t when)
+	{
+		if (type == Transaction_Type::Transfer_Out)
+			*balance -= amt;
+		else
+			*balance += amt;
+		Transaction tran(customer_number, type, amt, schedule->check_charge, schedule->overdraft_penalty,
+				counterparty, when);
+		transactions.append(tran);
+		if (journal)
+			journal->append(account_number, tran);
+	}
+
+	/**
+	Take the fees a withdrawal incurs, in the same pass as the withdrawal itself: the check
+	charge if this is a checking account, then the overdraft penalty if the balance has gone
+	below zero.  Both come from the schedule the account already holds, so nothing is looked up.
+	Shared by every withdrawal path, so fees are the same however the withdrawal is posted.
+	@param bal	The balance after the withdrawal; the fees are taken from it
+	@param post	Called as post(type, fee) for each fee taken, to record it
+	*/
+	template <typename Post>
+	void charge_withdrawal_fees(Money &bal, Post post) const
+	{
+		if (type == Account_Type::Checking) {
+			bal -= schedule->check_charge;
+			post(Transaction_Type::Check_Charge, schedule->check_charge);
+		}
+		if (bal < Money()) {
+			bal -= schedule->overdraft_penalty;
+			post(Transaction_Type::Overdraft_Penalty, schedule->overdraft_penalty);
+		}
+	}
+
+	/**
+	Hand this account to another customer.  Only the Bank does this (Bank::reassign_account),
+	as it must also move the account in its customer index.
+	@param cust The new owner
+	*/
+	void set_customer(Customer *cust) {
+		customer = cust;
+		customer_number = cust->get_customer_id();
+		schedule = &cust->get_fee_schedule();
+		if (store)
+			store->set_owner(row, cust->get_customer_id(), cust->get_tier());
+	}
+
+	/**
+	Add interest based on a specified interest rate to account
+	@param interest	The interest rate
+	*/
+	void add_interest(Rate interest) {
+        //Calculate the interest and credit it
+		post_interest(balance->times(interest));
+	}
+
+public:
+	/**
+	Constructor requires a customer to create an account
+	Balance always starts with 0 when account is created.
+	*/
+	Account(Customer *cust, int id, Account_Type type) : balance(&local_balance), schedule(&cust->get_fee_schedule()),
+		journal(NULL), account_number(id), customer_number(cust->get_customer_id()), type(type), customer(cust),
+		local_balance(), store(NULL), row(0) {}
+
+	// The balance pointer may refer to our own member, so accounts are not copied
+	Account(const Account &) = delete;
+	Account &operator=(const Account &) = delete;
+
+	/**
+	Move this account's balance into a row of a column store; from now on the account is a
+	handle over that row.  Done by the Bank when the account is opened.
+	@param store_	The store
+	@param row_		The row that belongs to this account
+	*/
+	void attach(Account_Store *store_, size_t row_) {
+		store = store_;
+		row = row_;
+		Money *slot = store->balance(row);
+		*slot = *balance;
+		balance = slot;
+	}
+
+	virtual ~Account() {}
+
+	/**
+	Generic accesser and setter methods for properties customer, balance, and account_number
+	*/
+
+	Customer *get_customer() {
+		return customer;
+	}
+
+	/**
+	Describe fees associated with the customer who owns this account.
+	The fee will depend on the specific type of customer.  The description is only
+	formatted when it is printed, so this is meant for reports, not the posting path.
+	@return summary showing checking and overdraft fees
+	*/
+	Fee_Summary get_fees() const {
+		return Fee_Summary(*schedule);
+	}
+
+	int get_account() {
+		return account_number;
+	}
+
+	void set_balance(Money new_balance) {
+		*balance = new_balance;
+	}
+
+	Money get_balance() const {
+		return *balance;
+	}
+
+	const Transaction_Log &get_transactions() const {
+		return transactions;
+	}
+
+	Account_Type get_type() const {
+		return type;
+	}
+
+	/**
+	The interest rate this account earns, which depends on the account type and the customer's tier
+	@return the interest rate
+	*/
+	Rate get_interest_rate() const {
+		return type == Account_Type::Savings ? schedule->savings_interest : schedule->check_interest;
+	}
+
+	/**
+	Credit interest that has already been calculated, and record it.
+	Shared by add_interest(Rate) and the bank-wide Bank::accrue_interest run, so both
+	produce the same balance and the same record for the same amount.
+	@param amt The interest amount
+	*/
+	void post_interest(Money amt) {
+		*balance = *balance + amt;
+		record(Transaction_Type::Interest, amt, Transaction::posting_time());
+	}
+
+	/**
+	Generic method describing the account information, including whether it is Savings or Checking.
+
+	@return string describing generic information about the account
+	*/
+    
+    //Function prototype that is defined later in the class
+    virtual std::string to_string();
+
+	/**
+	Append the description of this account to a buffer, as to_string() does, but without
+	building any temporaries.  Nothing is allocated once the buffer has room.
+	@param out The buffer to append to
+	*/
+	void render(std::string &out) const;
+
+	/**
+	Deposits amount into account.  Deposits, withdrawals, fees and interest on every kind of
+	account are all posted and recorded here in Account; the subclasses only choose the interest rate.
+	@param amt The deposit amount
+	*/
+	virtual void deposit(Money amt) {
+        //Calculate the deposit amount
+		*balance += amt;
+        //Record the transaction in this account's log
+		record(Transaction_Type::Deposit, amt, Transaction::posting_time());
+	}
+
+	/**
+	Withdraws amount from account, then takes any check charge or overdraft penalty
+	@param amt The withdrawal amount
+	*/
+	virtual void withdraw(Money amt) {
+		int64_t when = Transaction::posting_time();
+        //Calculate the withdrawal amount
+		Money bal = *balance - amt;
+        //Record the transaction in this account's log
+		record(Transaction_Type::Withdrawal, amt, when);
+		charge_withdrawal_fees(bal, [this, when](Transaction_Type fee_type, Money fee) { record(fee_type, fee, when); });
+		*balance = bal;
+	}
+
+	// Savings_Account and Checking_Account implement this
+	virtual void add_interest() = 0;
+
+};
+
+//Savings_Account IS-A Account
+class Savings_Account: public Account{
+
+public:
+    //Constructor for Savings_Account
+    Savings_Account(Customer *cust, int id) : Account(cust, id, Account_Type::Savings) {};
+    //Function to add (and record) interest at the customer's savings rate
+    void add_interest()
+    {
+        Account::add_interest(schedule->savings_interest);
+    }
+};
+
+//Checking_Account IS-A Account
+class Checking_Account: public Account{
+    
+public:
+    //Constructor for Checking_Account
+    Checking_Account(Customer *cust, int id) : Account(cust, id, Account_Type::Checking) {};
+    //Function to add (and record) interest at the customer's checking rate
+    void add_interest()
+    {
+        Account::add_interest(schedule->check_interest);
+    }
+};
+
+inline std::string Account::to_string() {
+    std::string text;
+    render(text);
+    return text;
+}
+
+inline void Account::render(std::string &out) const {
+    char number[32];  // Scratch space for formatting numbers, big enough for any Money, Rate or int
+    auto line = [&out](std::string_view label, std::string_view value) {
+        out.append("  ").append(label).append(": ").append(value).push_back('\n');
+    };
+    auto integer = [&number](long long value) {
+        return std::string_view(number, std::to_chars(number, number + sizeof(number), value).ptr - number);
+    };
+    auto money = [&number](Money value) {
+        return std::string_view(number, value.format(number) - number);
+    };
+    auto rate = [&number](Rate value) {
+        return std::string_view(number, value.format(number) - number);
+    };
+
+    //Add information about the customer who owns this account
+    line("Name", customer->get_name());
+    line("Customer ID number", integer(customer->get_customer_id()));
+    line("Address", customer->get_address());
+    line("Phone number", customer->get_telephone_number());
+    line("Age", integer(customer->get_age()));
+    line("Customer type", customer->get_cust_type());
+    line("Balance", money(*balance));
+    line("Account ID", integer(account_number));
+    line("Savings interest", rate(schedule->savings_interest));
+    line("Checking interest", rate(schedule->check_interest));
+    line("Check charge", money(schedule->check_charge));
+    line("Overdraft fee", money(schedule->overdraft_penalty));
+    line("Account type", account_type_name(type));
+}
+
+#endif
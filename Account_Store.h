@@ -0,0 +1,177 @@
+#ifndef ACCOUNT_STORE_H_
+#define ACCOUNT_STORE_H_
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include "Customer.h"
+
+class Account;
+
+/**
+The kinds of account, used to tell accounts apart without a virtual call or typeid
+*/
+enum class Account_Type : uint8_t
+{
+	Savings,
+	Checking
+};
+
+/**
+Name of an account type, as shown in statements
+*/
+inline const char *account_type_name(Account_Type type)
+{
+	return type == Account_Type::Savings ? "Savings" : "Checking";
+}
+
+/**
+Column-oriented storage for the hot fields of every account in a bank.
+
+Instead of each Account carrying its own balance, the bank keeps one column per field
+(account object, account number, balance, type, customer id and customer tier) and the
+Account objects point into it.  Bank-wide scans such as totals, overdraft checks and
+interest runs then walk plain arrays rather than chasing a pointer per account.
+
+Rows are stored in fixed-size blocks, so a row never moves once added and an Account
+can safely hold a pointer to its balance.  Row numbers are handed out in order, starting at 0.
+
+The store also serves as the bank's account index, and it can be read while rows are being
+added: the block directory has a fixed size, and the row count is published only after a
+new row is filled in.  Rows must be added by one thread at a time.
+*/
+class Account_Store
+{
+public:
+	static constexpr size_t BLOCK_ROWS = 4096;
+	static constexpr size_t MAX_BLOCKS = 1 << 14;	// Room for about 67 million accounts
+
+	/**
+	One block of rows, column by column
+	*/
+	struct Block
+	{
+		Account *account[BLOCK_ROWS];
+		int account_number[BLOCK_ROWS];
+		Money balance[BLOCK_ROWS];
+		int customer_id[BLOCK_ROWS];
+		Account_Type type[BLOCK_ROWS];
+		Customer_Tier tier[BLOCK_ROWS];
+	};
+
+private:
+	std::unique_ptr<Block *[]> blocks;	// Directory of MAX_BLOCKS entries, filled in as needed
+	size_t allocated = 0;				// Number of blocks allocated so far
+	std::atomic<size_t> rows;			// Number of rows in use, published after each row is filled in
+
+	/**
+	Allocate the next block
+	*/
+	void grow()
+	{
+		if (allocated == MAX_BLOCKS)
+			throw std::length_error("account store is full");
+		blocks[allocated++] = new Block;
+	}
+
+public:
+	Account_Store() : blocks(new Block *[MAX_BLOCKS]()), rows(0) {}
+
+	~Account_Store()
+	{
+		for (size_t b = 0; b < allocated; b++)
+			delete blocks[b];
+	}
+
+	Account_Store(const Account_Store &) = delete;
+	Account_Store &operator=(const Account_Store &) = delete;
+
+	/**
+	Add a row for a new account, with a zero balance
+	@param acct				The account object
+	@param account_number	The account id
+	@param type				Savings or checking
+	@param customer_id		The owning customer's id
+	@param tier				The owning customer's tier
+	@return the row number
+	*/
+	size_t add(Account *acct, int account_number, Account_Type type, int customer_id, Customer_Tier tier)
+	{
+		size_t row = rows.load(std::memory_order_relaxed);
+		if (row == allocated * BLOCK_ROWS)
+			grow();
+		Block &block = *blocks[row / BLOCK_ROWS];
+		size_t i = row % BLOCK_ROWS;
+		block.account[i] = acct;
+		block.account_number[i] = account_number;
+		block.balance[i] = Money();
+		block.type[i] = type;
+		block.customer_id[i] = customer_id;
+		block.tier[i] = tier;
+		// Readers that see the new row count also see the row
+		rows.store(row + 1, std::memory_order_release);
+		return row;
+	}
+
+	/**
+	Allocate blocks ahead of time for a batch of new rows
+	@param count Total number of rows expected
+	*/
+	void reserve(size_t count)
+	{
+		while (allocated * BLOCK_ROWS < count)
+			grow();
+	}
+
+	/**
+	Find the account in a row.  Safe to call while another thread is adding rows.
+	@param row The row number
+	@return the account object, or NULL if there is no such row
+	*/
+	Account *account(size_t row) const
+	{
+		if (row >= rows.load(std::memory_order_acquire))
+			return NULL;
+		return blocks[row / BLOCK_ROWS]->account[row % BLOCK_ROWS];
+	}
+
+	/**
+	Change the owner recorded for a row
+	@param row			The row number
+	@param customer_id	The new owner's id
+	@param tier			The new owner's tier
+	*/
+	void set_owner(size_t row, int customer_id, Customer_Tier tier)
+	{
+		Block &block = *blocks[row / BLOCK_ROWS];
+		block.customer_id[row % BLOCK_ROWS] = customer_id;
+		block.tier[row % BLOCK_ROWS] = tier;
+	}
+
+	/**
+	@param row The row number
+	@return the balance of that row, which stays at this address for the life of the store
+	*/
+	Money *balance(size_t row)
+	{
+		return &blocks[row / BLOCK_ROWS]->balance[row % BLOCK_ROWS];
+	}
+
+	size_t size() const { return rows.load(std::memory_order_acquire); }
+	size_t block_count() const { return (size() + BLOCK_ROWS - 1) / BLOCK_ROWS; }
+	Block &block(size_t b) { return *blocks[b]; }
+	const Block &block(size_t b) const { return *blocks[b]; }
+
+	/**
+	@param b The block number
+	@return how many rows of that block are in use
+	*/
+	size_t block_size(size_t b) const
+	{
+		return std::min(BLOCK_ROWS, size() - b * BLOCK_ROWS);
+	}
+};
+
+#endif
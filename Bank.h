@@ -1,261 +1,787 @@
-#ifndef BANK_H_
-#define BANK_H_
-#include <vector>
-#include <stdexcept>
-#include "Account.h"
-#include "Customer.h"
-
-/**
-The CS273 Bank has Accounts and Customers
-
-@author: Ed Walker
-*/
-class Bank
-{
-private:
-	std::vector<Account *> accounts; // Bank HAS accounts
-	std::vector<Customer *> customers;  // Bank HAS customers
-    //Use dynamic/type_id to walk through and figure out who's seniors, students, adults, etc.
-	
-	// Counters for generating unique account and customer IDs
-	int account_id = 0;
-	int customer_id = 0;
-
-
-	/**
-	Return a vector of accounts owned by the specified name of the customer.
-	Remember a customer can have many accounts.  
-	@param name The customer name 
-	@return vector of account ids
-	*/
-    
-    //Go through accounts vector instead
-	std::vector<int> find_accounts_by_name(std::string name)
-	{
-		std::vector<int> user_accounts;
-        
-        //Find all the accounts belonging to a customer name and add it to the vector of account numbers
-        for(int j = 0; j < accounts.size(); j++)
-        {
-            //Create Customer object pointing to the customer's accounts
-            Customer *C1 = accounts[j]->get_customer();
-            //Create an account object
-            Account *A1 = accounts[j];
-            
-            //Get the customer's account
-            int acct_id = A1->get_account();
-            
-            //Get's the customer's name
-            string name_ = C1->get_name();
-            
-            //If the customer's name matches the input name, add the account to the user_accounts vector
-            if(name_ == name)
-            {
-                user_accounts.push_back(acct_id);
-            }
-        }
-        
-		return user_accounts;
-	}
-
-	/**
-	Find a customer based on his/her name
-	@param name The customer name
-	@return customer object if found, NULL otherwise
-	*/
-	Customer *find_customer(std::string name)
-	{
-		// Find and return the Customer object with the parameter name
-        //Loops through the vector of Customer objects
-        for(size_t i = 0; i < customers.size(); i++){
-            //If input name matches a name in the Customer vector, return that Customer object
-            if (customers[i]->get_name() == name)
-            {
-                return customers[i];
-       
-            }
-        }
-        //If no customer with that name is found, return NULL
-        return NULL;
-	}
-    
-	/**
-	Add a new account to a customer object (irrespective of its specific type: adult, senior, or student)
-	@param cust The customer object 
-	@param account_type The account type, i.e. "savings" or "checking"
-	@return the newly created account object
-	*/
-	Account * add_account (Customer *cust, std::string account_type)
-	{
-		Account *acct = NULL;
-        //Factory method for creating a Account object (could be a Saving_Account or a Checking_Account).
-        for (int i = 0; i < customers.size(); i++)
-        {
-            //Get customer's name
-            string cust_name = cust->get_name();
-            //Customer object exists that agrees with the Customer object passed in
-            if (customers[i]->get_name() == cust_name)
-            {
-                //If Customer wants to create a savings account
-                if(account_type == "savings")
-                {
-                    //increment account_id
-                    ++account_id;
-                    //Create a new Savings_Account object
-                    acct = new Savings_Account(cust, account_id);
-                }
-                //If Customer wants to create a checking account
-                else if(account_type == "checking")
-                {
-                    //increment account_id
-                    ++account_id;
-                    //Create a ne Checking_Account object
-                    acct = new Checking_Account(cust, account_id);
-                }
-                //Add the new account to the accounts vector
-                accounts.push_back(acct);
-            }
-        }
-
-		return acct;
-	}
-
-public:
-	/** Constructor
-	*/
-	Bank() : account_id(1000), customer_id(1000) {}
-
-	/**
-	Add account for an existing user
-	@param name The customer name
-	@param account_type The account type, i.e. "checking" or "savings"
-	@return the newly created account object if the customer exist, or NULL otherwise
-	*/
-	Account* add_account(std::string name, std::string account_type) 
-	{
-		Customer *cust = find_customer(name);
-		if (cust == NULL)
-			return NULL;
-		return add_account(cust, account_type);
-	}
-
-	/** 
-	Add account for new user.  This creates a new customer and adds an account to him/her.
-	@param name Customer name
-	@param address Customer address
-	@param telephone Customer telephone number
-	@param age Customer age
-	@param cust_type Customer type, i.e. "adult", "senior" or "student"
-	@param account_type Account type, i.e. "checking" or "savings"
-	@return the newly created account object
-	*/
-	Account* add_account(std::string name, std::string address, std::string telephone, int age,
-            std::string cust_type, std::string account_type)
-	{
-        //Create a new Customer object
-		Customer *cust = NULL;
-        
-		// Depending on the customer type, we want to create an Adult, Senior, or Student object.
-        //Set name, address, phone number, age, and customer type for the Customer object
-        
-        //If customer is type "adult"
-        if (cust_type == "adult")
-        {
-            //Increment the customer ID and assign that value to cust
-            ++customer_id;
-            //Create new Adult object
-            cust = new Adult (customer_id, name, cust_type);
-            cust->set_customer_id(customer_id);
-        }
-        //If customer is type "senior"
-        else if (cust_type == "senior")
-        {
-            //Increment the customer ID and assign that value to cust
-            ++customer_id;
-            //Create new Senior object
-            cust = new Senior (customer_id, name, cust_type);
-        }
-        //If customer is type "student"
-        else if (cust_type == "student")
-        {
-            //Increment the customer ID and assign that value to cust
-            ++customer_id;
-            //Create new Student object
-            cust = new Student (customer_id, name, cust_type);
-        }
-        
-        cust->set_customer_id(customer_id);
-        cust->set_name(name);
-        cust->set_address(address);
-        cust->set_telephone_number(telephone);
-        cust->set_age(age);
-        cust->set_cust_type(cust_type);
-        
-        customers.push_back(cust);
-		return add_account(cust, account_type);
-	}
-
-	/**
-	Make a deposit in an account identified by the account id
-	@param acct_number	The account id
-	@param amt			The amount to deposit
-	*/
-	void make_deposit(int acct_number, double amt) 
-	{
-        //Get the account's number
-		Account *acct = get_account(acct_number);
-        //If the account exists, deposit the amount
-		if (acct) {
-            acct->deposit(amt);
-		}
-        //If the account doesn't exist, inform the user
-        else {
-            cout << "Sorry, account " << acct_number << " could not be found." << endl;
-        }
-	}
-
-	/** 
-	Make a withdrawal in an account identified by the account id
-	@param acct_number	The account id
-	@param amt			The amount to withdraw
-	*/
-	void make_withdrawal(int acct_number, double amt) 
-	{
-        //Get the account's number
-		Account *acct = get_account(acct_number);
-        //If the account exists, withdraw the amount
-		if (acct) {
-            acct->withdraw(amt);
-		}
-        //If the account doesn't exist, inform the user
-        else {
-            cout << "Sorry, account " << acct_number << " could not be found." << endl;
-        }
-	}
- 
-	/**
-	Get the list of account numbers associated with a user, identified by his/her name
-	@param name The customer name
-	@return vector of account ids
-	*/
-	std::vector<int> get_account(std::string name) 
-	{
-		return find_accounts_by_name(name);
-	}
-
-	/**
-	Get the account object for an account identified by an account id
-	@param acct_name The account id
-	@return the account object if it exists, NULL otherwise
-	*/
-	Account *get_account(int acct_number)
-	{
-		for (size_t i = 0; i < accounts.size(); i++) {
-			if (accounts[i]->get_account() == acct_number)
-				return accounts[i];
-		}
-		return NULL;
-	}
-};
-
-#endif
+#ifndef BANK_H_
+#define BANK_H_
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Account.h"
+#include "Customer.h"
+#include "Instrumentation.h"
+
+/**
+Everything needed to open an account in a batch, see Bank::add_accounts.
+The customer fields are only used if no customer with this name exists yet.
+*/
+struct Account_Request
+{
+	std::string name;
+	std::string address;
+	std::string telephone;
+	int age;
+	std::string cust_type;		// "adult", "senior" or "student"
+	std::string account_type;	// "checking" or "savings"
+};
+
+/**
+A transfer between two accounts of the same bank, see Bank::transfer
+*/
+struct Transfer_Request
+{
+	int from;		// Account the money leaves
+	int to;			// Account the money goes to
+	Money amount;
+};
+
+/**
+The CS273 Bank has Accounts and Customers
+
+A bank created in concurrent mode may be used from many threads at once.  Account lookups
+by id never lock; postings lock only the account they touch (through a stripe of account
+locks), so postings to different accounts proceed in parallel; opening accounts and looking
+customers up by name share a reader/writer lock.  Bank-wide operations such as interest runs
+lock every stripe.  In concurrent mode, postings must go through the Bank (make_deposit,
+make_withdrawal) rather than straight to the Account objects.
+
+@author: Ed Walker
+*/
+class Bank : public Customer_Listener
+{
+	// Snapshots and exports read (and snapshots rebuild) the bank's containers directly
+	friend class Snapshot;
+	friend class Columnar_Export;
+
+private:
+	std::vector<Customer *> customers;  // Bank HAS customers
+	Account_Store store;  // Bank HAS accounts: the account objects, and their balance, type and owner, column by column
+    //Use dynamic/type_id to walk through and figure out who's seniors, students, adults, etc.
+	
+	// Counters for generating unique account and customer IDs
+	std::atomic<int> account_id;
+	std::atomic<int> customer_id;
+
+	// Account ids are handed out sequentially starting after this value, so the
+	// store doubles as a dense index: account N lives in row N - FIRST_ACCOUNT_ID - 1
+	static const int FIRST_ACCOUNT_ID = 1000;
+	static const int FIRST_CUSTOMER_ID = 1000;
+
+	// Interest runs look rates up by (account type, customer tier)
+	static const int ACCOUNT_TYPES = 2;
+	static const int CUSTOMER_TIERS = 3;
+
+	// Concurrent mode: account N is guarded by stripe N % STRIPES, and everything else
+	// (customers, name indexes, opening accounts) by directory_lock
+	static const int STRIPES = 1024;
+	struct alignas(64) Stripe
+	{
+		std::mutex lock;
+	};
+	bool concurrent;
+	std::unique_ptr<Stripe[]> stripes;
+	mutable std::shared_mutex directory_lock;
+
+	Journal *journal = NULL;	// Every posting is also appended here, if set
+
+#ifdef BANK_INSTRUMENT
+	Bank_Instrumentation instrumentation;	// What BANK_PROBE collects, see Instrumentation.h
+#endif
+
+	/**
+	Lock the stripe guarding an account (only in concurrent mode)
+	@param acct_number The account id
+	@return the held lock, or an empty one if the bank is not concurrent
+	*/
+	std::unique_lock<std::mutex> lock_account(int acct_number) const
+	{
+		if (!concurrent)
+			return std::unique_lock<std::mutex>();
+		return std::unique_lock<std::mutex>(stripes[(unsigned)acct_number % STRIPES].lock);
+	}
+
+	/**
+	Lock every account stripe, in order, for a bank-wide operation (only in concurrent mode)
+	@return the held locks
+	*/
+	std::vector<std::unique_lock<std::mutex>> lock_all_accounts() const
+	{
+		std::vector<std::unique_lock<std::mutex>> locks;
+		if (concurrent) {
+			locks.reserve(STRIPES);
+			for (int i = 0; i < STRIPES; i++)
+				locks.emplace_back(stripes[i].lock);
+		}
+		return locks;
+	}
+
+	/**
+	Take the directory lock for reading (only in concurrent mode)
+	*/
+	std::shared_lock<std::shared_mutex> read_directory() const
+	{
+		if (!concurrent)
+			return std::shared_lock<std::shared_mutex>();
+		return std::shared_lock<std::shared_mutex>(directory_lock);
+	}
+
+	/**
+	Take the directory lock for writing (only in concurrent mode)
+	*/
+	std::unique_lock<std::shared_mutex> write_directory() const
+	{
+		if (!concurrent)
+			return std::unique_lock<std::shared_mutex>();
+		return std::unique_lock<std::shared_mutex>(directory_lock);
+	}
+
+
+	// Secondary indexes, kept in sync by add_account and by the customers' setters (see text_changing).
+	// The name keys are views of each customer's own name, so building and probing them copies no strings.
+	std::unordered_multimap<std::string_view, Customer *> customers_by_name;
+	std::unordered_map<const Customer *, std::vector<int>> accounts_by_customer;
+
+	/**
+	Return a vector of accounts owned by the specified name of the customer.
+	Remember a customer can have many accounts.  
+	@param name The customer name 
+	@return vector of account ids
+	*/
+	std::vector<int> find_accounts_by_name(std::string_view name)
+	{
+		std::vector<int> user_accounts;
+		auto range = customers_by_name.equal_range(name);
+		
+		//Collect the accounts of every customer going by this name
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			auto ids = accounts_by_customer.find(it->second);
+			if (ids != accounts_by_customer.end())
+				user_accounts.insert(user_accounts.end(), ids->second.begin(), ids->second.end());
+		}
+		//Several customers share the name: put their accounts back in the order they were opened
+		if (range.first != range.second && std::next(range.first) != range.second)
+			std::sort(user_accounts.begin(), user_accounts.end());
+		
+		return user_accounts;
+	}
+
+	/**
+	Find a customer based on his/her name
+	@param name The customer name
+	@return customer object if found, NULL otherwise
+	*/
+	Customer *find_customer(std::string_view name)
+	{
+		Customer *found = NULL;
+		auto range = customers_by_name.equal_range(name);
+		
+		//If several customers share the name, the one who joined first wins
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (found == NULL || it->second->get_customer_id() < found->get_customer_id())
+				found = it->second;
+		}
+		//If no customer with that name is found, return NULL
+		return found;
+	}
+
+	/**
+	Remove a customer from the name index
+	@param cust The customer object
+	*/
+	void unindex_name(Customer *cust)
+	{
+		auto range = customers_by_name.equal_range(cust->get_name());
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (it->second == cust)
+			{
+				customers_by_name.erase(it);
+				return;
+			}
+		}
+	}
+    
+	/**
+	Customer_Listener: change a customer's text under the directory lock.  The name index
+	keys are views of the text, which moves whichever field changes, so the customer is
+	taken out of the index and put back around the change.
+	@param cust		The customer object
+	@param field	The field to change
+	@param value	The new text
+	*/
+	void text_changing(Customer *cust, Customer_Field field, std::string_view value) override
+	{
+		auto lock = write_directory();
+		unindex_name(cust);
+		rewrite(cust, field, value);
+		customers_by_name.emplace(cust->get_name(), cust);
+	}
+
+	/**
+	Add a new account to a customer object (irrespective of its specific type: adult, senior, or student).
+	The customer must already belong to this bank; exactly one account is opened, in constant time.
+	The caller holds the directory lock for writing.
+	@param cust The customer object 
+	@param account_type The account type, i.e. "savings" or "checking"
+	@return the newly created account object, or NULL if the account type is unknown
+	*/
+	Account * add_account (Customer *cust, std::string_view account_type)
+	{
+		Account *acct = NULL;
+        //Factory method for creating a Account object (could be a Saving_Account or a Checking_Account).
+        //If Customer wants to create a savings account
+        if (account_type == "savings")
+        {
+            //increment account_id and create a new Savings_Account object
+            acct = new Savings_Account(cust, ++account_id);
+        }
+        //If Customer wants to create a checking account
+        else if (account_type == "checking")
+        {
+            //increment account_id and create a new Checking_Account object
+            acct = new Checking_Account(cust, ++account_id);
+        }
+        //Give the new account its row in the store (its row matches its id, see get_account)
+        if (acct)
+        {
+            acct->attach(&store, store.add(acct, acct->get_account(), acct->get_type(), cust->get_customer_id(), cust->get_tier()));
+            acct->journal = journal;
+            accounts_by_customer[cust].push_back(acct->get_account());
+        }
+
+		return acct;
+	}
+
+	/**
+	Create a new customer and register it with the bank.
+	The caller holds the directory lock for writing.
+	@param name Customer name
+	@param address Customer address
+	@param telephone Customer telephone number
+	@param age Customer age
+	@param cust_type Customer type, i.e. "adult", "senior" or "student"
+	@return the newly created customer object, or NULL if the customer type is unknown
+	*/
+	Customer *add_customer(std::string_view name, std::string_view address, std::string_view telephone,
+            int age, std::string_view cust_type)
+	{
+        //Create a new Customer object
+		Customer *cust = NULL;
+        
+		// Depending on the customer type, we want to create an Adult, Senior, or Student object.
+        //If customer is type "adult"
+        if (cust_type == "adult")
+            cust = new Adult (customer_id + 1, name);
+        //If customer is type "senior"
+        else if (cust_type == "senior")
+            cust = new Senior (customer_id + 1, name);
+        //If customer is type "student"
+        else if (cust_type == "student")
+            cust = new Student (customer_id + 1, name);
+        else
+            return NULL;
+        
+        //Only use up a customer ID once we know the customer type is valid
+        ++customer_id;
+        //Set address, phone number and age for the Customer object
+        cust->set_address(address);
+        cust->set_telephone_number(telephone);
+        cust->set_age(age);
+        
+        customers.push_back(cust);
+        //Index the customer by name and follow any later renames
+        customers_by_name.emplace(cust->get_name(), cust);
+        cust->set_listener(this);
+		return cust;
+	}
+
+	/**
+	Move the money for a transfer and record both legs.  The caller holds both accounts' locks.
+	@param source	The account the money leaves
+	@param dest		The account the money goes to
+	@param amt		The amount to transfer
+	@return true if the transfer was made, false if the amount is not positive or not available
+	*/
+	bool apply_transfer(Account *source, Account *dest, Money amt)
+	{
+		if (amt <= Money() || source->get_balance() < amt)
+			return false;
+		int64_t when = Transaction::posting_time();
+		source->post_transfer(Transaction_Type::Transfer_Out, amt, dest->get_account(), when);
+		dest->post_transfer(Transaction_Type::Transfer_In, amt, source->get_account(), when);
+		return true;
+	}
+
+	/**
+	Re-apply a posting read back from a journal: adjust the balance and restore the record,
+	without journaling it again.  The caller holds the locks.
+	@param acct_number	The account the posting was made to
+	@param tran			The transaction record
+	@return true if applied, false if there is no such account
+	*/
+	bool replay_posting(int acct_number, const Transaction &tran)
+	{
+		Account *acct = get_account(acct_number);
+		if (acct == NULL)
+			return false;
+		switch (tran.get_type()) {
+		case Transaction_Type::Deposit:
+		case Transaction_Type::Interest:
+		case Transaction_Type::Transfer_In:
+			*acct->balance += tran.get_amount();
+			break;
+		case Transaction_Type::Withdrawal:
+		case Transaction_Type::Transfer_Out:
+		case Transaction_Type::Check_Charge:
+		case Transaction_Type::Overdraft_Penalty:
+			*acct->balance -= tran.get_amount();
+			break;
+		}
+		acct->transactions.append(tran);
+		return true;
+	}
+
+public:
+	/** Constructor
+	@param concurrent_ Whether the bank will be used from several threads at once
+	*/
+	explicit Bank(bool concurrent_ = false) : account_id(FIRST_ACCOUNT_ID), customer_id(FIRST_CUSTOMER_ID),
+		concurrent(concurrent_), stripes(concurrent_ ? new Stripe[STRIPES] : NULL) {}
+
+	/** Destructor: the bank owns its accounts (and their transaction logs) and its customers
+	*/
+	~Bank()
+	{
+		for (size_t row = 0; row < store.size(); row++)
+			delete store.account(row);
+		for (Customer *cust : customers)
+			delete cust;
+	}
+
+	// A bank owns raw pointers, so it cannot be copied
+	Bank(const Bank &) = delete;
+	Bank &operator=(const Bank &) = delete;
+
+	/**
+	Start (or stop) writing every posting to a journal: deposits, withdrawals, interest and transfers.
+	The bank does not own the journal, which must outlive it or be replaced first.
+	@param journal_ The journal, or NULL to stop journaling
+	*/
+	void set_journal(Journal *journal_)
+	{
+		auto directory = write_directory();
+		auto locks = lock_all_accounts();
+		journal = journal_;
+		for (size_t row = 0; row < store.size(); row++)
+			store.account(row)->journal = journal;
+	}
+
+	/**
+	Add account for an existing user
+	@param name The customer name
+	@param account_type The account type, i.e. "checking" or "savings"
+	@return the newly created account object if the customer exist, or NULL otherwise
+	*/
+	Account* add_account(std::string_view name, std::string account_type) 
+	{
+		BANK_PROBE(Bank_Op::Open_Account);
+		auto lock = write_directory();
+		Customer *cust = find_customer(name);
+		if (cust == NULL)
+			return NULL;
+		return add_account(cust, account_type);
+	}
+
+	/** 
+	Add account for new user.  This creates a new customer and adds an account to him/her.
+	@param name Customer name
+	@param address Customer address
+	@param telephone Customer telephone number
+	@param age Customer age
+	@param cust_type Customer type, i.e. "adult", "senior" or "student"
+	@param account_type Account type, i.e. "checking" or "savings"
+	@return the newly created account object
+	*/
+	Account* add_account(std::string name, std::string address, std::string telephone, int age,
+            std::string cust_type, std::string account_type)
+	{
+		BANK_PROBE(Bank_Op::Onboard_Customer);
+		auto lock = write_directory();
+		Customer *cust = add_customer(name, address, telephone, age, cust_type);
+		if (cust == NULL)
+			return NULL;
+		return add_account(cust, account_type);
+	}
+
+	/**
+	Open many accounts in one call, e.g. when onboarding a batch of customers.
+	Each request behaves like the interactive "Add Account": the account goes to the existing
+	customer with that name, and a new customer is created from the request if there is none.
+	Capacity for the whole batch is reserved up front, so the vectors and indexes grow at most once.
+	@param requests The accounts to open
+	@return the newly created account objects, in request order (NULL where a request was invalid)
+	*/
+	std::vector<Account *> add_accounts(const std::vector<Account_Request> &requests)
+	{
+		BANK_PROBE(Bank_Op::Open_Batch);
+		auto lock = write_directory();
+		std::vector<Account *> opened;
+		opened.reserve(requests.size());
+		store.reserve(store.size() + requests.size());
+		customers.reserve(customers.size() + requests.size());
+		customers_by_name.reserve(customers.size() + requests.size());
+		accounts_by_customer.reserve(customers.size() + requests.size());
+		
+		for (const Account_Request &req : requests)
+		{
+			Customer *cust = find_customer(req.name);
+			if (cust == NULL)
+				cust = add_customer(req.name, req.address, req.telephone, req.age, req.cust_type);
+			opened.push_back(cust ? add_account(cust, req.account_type) : NULL);
+		}
+		return opened;
+	}
+
+	/**
+	Give an account to another existing customer.  The account moves between the two customers'
+	entries in the account index, and its fees follow the new owner's tier from now on.
+	@param acct_number	The account id
+	@param name			The new owner's name; if several customers share it, the one who joined first
+	@return true if the account now belongs to that customer, false if there is no such account or customer
+	*/
+	bool reassign_account(int acct_number, std::string_view name)
+	{
+		auto directory = write_directory();
+		Account *acct = get_account(acct_number);
+		Customer *cust = find_customer(name);
+		if (acct == NULL || cust == NULL)
+			return false;
+		if (acct->get_customer() == cust)
+			return true;
+
+		// Ids are appended in the order accounts are opened, so each customer's list stays sorted
+		std::vector<int> &from = accounts_by_customer[acct->get_customer()];
+		from.erase(std::find(from.begin(), from.end(), acct_number));
+		std::vector<int> &to = accounts_by_customer[cust];
+		to.insert(std::lower_bound(to.begin(), to.end(), acct_number), acct_number);
+
+		auto lock = lock_account(acct_number);
+		acct->set_customer(cust);
+		return true;
+	}
+
+	/**
+	Make a deposit in an account identified by the account id
+	@param acct_number	The account id
+	@param amt			The amount to deposit
+	*/
+	void make_deposit(int acct_number, Money amt) 
+	{
+		BANK_PROBE(Bank_Op::Deposit);
+        //Get the account's number
+		Account *acct = get_account(acct_number);
+        //If the account exists, deposit the amount
+		if (acct) {
+            auto lock = lock_account(acct_number);
+            acct->deposit(amt);
+		}
+        //If the account doesn't exist, inform the user
+        else {
+            cout << "Sorry, account " << acct_number << " could not be found." << endl;
+        }
+	}
+
+	/** 
+	Make a withdrawal in an account identified by the account id.
+	Any check charge or overdraft penalty is taken and recorded along with it.
+	@param acct_number	The account id
+	@param amt			The amount to withdraw
+	*/
+	void make_withdrawal(int acct_number, Money amt) 
+	{
+		BANK_PROBE(Bank_Op::Withdrawal);
+        //Get the account's number
+		Account *acct = get_account(acct_number);
+        //If the account exists, withdraw the amount
+		if (acct) {
+            auto lock = lock_account(acct_number);
+            acct->withdraw(amt);
+		}
+        //If the account doesn't exist, inform the user
+        else {
+            cout << "Sorry, account " << acct_number << " could not be found." << endl;
+        }
+	}
+ 
+	/**
+	Move money from one account to another, as a single atomic operation.
+	Both legs are recorded, each naming the other account and sharing one timestamp.
+	In concurrent mode the two accounts are locked in stripe order, so two transfers
+	running in opposite directions cannot deadlock.
+	@param from		The account id the money leaves
+	@param to		The account id the money goes to
+	@param amt		The amount to transfer
+	@return true if the transfer was made; false if an account does not exist, both ids are
+			the same, the amount is not positive, or the sending account has too little money
+	*/
+	bool transfer(int from, int to, Money amt)
+	{
+		BANK_PROBE(Bank_Op::Transfer);
+		Account *source = get_account(from);
+		Account *dest = get_account(to);
+		if (source == NULL || dest == NULL || from == to)
+			return false;
+		
+		//Lock the lower stripe first; two accounts on one stripe need only one lock
+		std::unique_lock<std::mutex> first, second;
+		if (concurrent) {
+			unsigned a = (unsigned)from % STRIPES, b = (unsigned)to % STRIPES;
+			first = std::unique_lock<std::mutex>(stripes[std::min(a, b)].lock);
+			if (a != b)
+				second = std::unique_lock<std::mutex>(stripes[std::max(a, b)].lock);
+		}
+		return apply_transfer(source, dest, amt);
+	}
+
+	/**
+	Make a batch of transfers, all or none.  In concurrent mode every stripe the batch touches
+	is locked once, in stripe order, and the whole batch is checked and applied under those
+	locks.  The transfers are checked in request order against the balances as the earlier
+	ones leave them, so a transfer may spend money an earlier one in the batch brought in.
+	@param requests The transfers to make
+	@return true if every transfer was made; false if any would be rejected by
+			transfer(int, int, Money), in which case none is made
+	*/
+	bool transfer(const std::vector<Transfer_Request> &requests)
+	{
+		BANK_PROBE(Bank_Op::Transfer_Batch);
+		std::vector<std::unique_lock<std::mutex>> locks;
+		if (concurrent) {
+			std::vector<unsigned> touched;
+			touched.reserve(requests.size() * 2);
+			for (const Transfer_Request &req : requests) {
+				touched.push_back((unsigned)req.from % STRIPES);
+				touched.push_back((unsigned)req.to % STRIPES);
+			}
+			std::sort(touched.begin(), touched.end());
+			touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+			locks.reserve(touched.size());
+			for (unsigned stripe : touched)
+				locks.emplace_back(stripes[stripe].lock);
+		}
+
+		// Check the whole batch against running balances before moving any money
+		std::vector<std::pair<Account *, Account *>> legs;
+		legs.reserve(requests.size());
+		std::unordered_map<Account *, Money> balances;
+		for (const Transfer_Request &req : requests) {
+			Account *source = get_account(req.from);
+			Account *dest = get_account(req.to);
+			if (source == NULL || dest == NULL || req.from == req.to || req.amount <= Money())
+				return false;
+			Money &from_balance = balances.emplace(source, source->get_balance()).first->second;
+			if (from_balance < req.amount)
+				return false;
+			from_balance -= req.amount;
+			balances.emplace(dest, dest->get_balance()).first->second += req.amount;
+			legs.emplace_back(source, dest);
+		}
+		for (size_t i = 0; i < requests.size(); i++)
+			apply_transfer(legs[i].first, legs[i].second, requests[i].amount);
+		return true;
+	}
+
+	/**
+	Month-end run: add interest to every account in the bank.
+
+	Works straight on the balance columns of the account store.  Each block of rows is
+	handled in three tight loops: compute every row's interest from a small rate table
+	indexed by (account type, customer tier), credit it to the balance column, then record
+	it in each account's log.  Blocks are shared out among the worker threads.  Interest is
+	worked out with Money::times, exactly as Account::add_interest(Rate) does, so the results
+	are identical to adding interest one account at a time.
+	@param threads Number of worker threads to use, or 0 for one per hardware thread
+	*/
+	void accrue_interest(unsigned threads = 0)
+	{
+		BANK_PROBE(Bank_Op::Interest_Run);
+		auto directory = read_directory();
+		auto locks = lock_all_accounts();
+
+		// The rate for every (account type, customer tier) pair
+		Rate rates[ACCOUNT_TYPES][CUSTOMER_TIERS];
+		for (int tier = 0; tier < CUSTOMER_TIERS; tier++) {
+			rates[(int)Account_Type::Savings][tier] = TIER_SCHEDULES[tier].savings_interest;
+			rates[(int)Account_Type::Checking][tier] = TIER_SCHEDULES[tier].check_interest;
+		}
+
+		int64_t when = Transaction::posting_time();	// One month-end run, one timestamp
+		std::atomic<size_t> next_block(0);
+		auto worker = [this, &rates, &next_block, when]() {
+			Money interest[Account_Store::BLOCK_ROWS];
+			for (size_t b = next_block++; b < store.block_count(); b = next_block++) {
+				Account_Store::Block &block = store.block(b);
+				size_t rows = store.block_size(b);
+				for (size_t i = 0; i < rows; i++)
+					interest[i] = block.balance[i].times(rates[(int)block.type[i]][(int)block.tier[i]]);
+				for (size_t i = 0; i < rows; i++)
+					block.balance[i] = block.balance[i] + interest[i];
+				for (size_t i = 0; i < rows; i++)
+					block.account[i]->record(Transaction_Type::Interest, interest[i], when);
+			}
+		};
+
+		if (threads == 0)
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		threads = (unsigned)std::min<size_t>(threads, store.block_count());
+		std::vector<std::thread> workers;
+		for (unsigned t = 1; t < threads; t++)
+			workers.emplace_back(worker);
+		worker();	// The calling thread does its share too
+		for (std::thread &w : workers)
+			w.join();
+	}
+
+	/**
+	Total of the balances of all accounts in the bank
+	@return the total
+	*/
+	Money total_deposits() const
+	{
+		auto directory = read_directory();
+		auto locks = lock_all_accounts();
+		Money total;
+		for (size_t b = 0; b < store.block_count(); b++) {
+			const Account_Store::Block &block = store.block(b);
+			for (size_t i = 0, rows = store.block_size(b); i < rows; i++)
+				total += block.balance[i];
+		}
+		return total;
+	}
+
+	/**
+	Find every account with a negative balance
+	@return vector of account ids
+	*/
+	std::vector<int> find_overdrawn_accounts() const
+	{
+		auto directory = read_directory();
+		auto locks = lock_all_accounts();
+		std::vector<int> overdrawn;
+		for (size_t b = 0; b < store.block_count(); b++) {
+			const Account_Store::Block &block = store.block(b);
+			for (size_t i = 0, rows = store.block_size(b); i < rows; i++) {
+				if (block.balance[i] < Money())
+					overdrawn.push_back(block.account_number[i]);
+			}
+		}
+		return overdrawn;
+	}
+
+	/**
+	Get the list of account numbers associated with a user, identified by his/her name
+	@param name The customer name
+	@return vector of account ids
+	*/
+	std::vector<int> get_account(std::string_view name) 
+	{
+		BANK_PROBE(Bank_Op::Name_Lookup);
+		auto lock = read_directory();
+		return find_accounts_by_name(name);
+	}
+
+	/**
+	Write the statement of every account owned by a customer name into a buffer: each account's
+	description followed by a separator line, then the number of accounts found.
+
+	The accounts are found in one pass over the name index and rendered in the order they
+	were opened, straight into the buffer.  Nothing else is allocated, so a caller that reuses
+	its buffer prints statements without touching the heap.
+	@param name	The customer name
+	@param out	The buffer to append to
+	@return the number of accounts rendered
+	*/
+	size_t render_statement(std::string_view name, std::string &out)
+	{
+		BANK_PROBE(Bank_Op::Statement);
+		auto lock = read_directory();
+		auto range = customers_by_name.equal_range(name);
+		size_t count = 0;
+
+		// Customers sharing a name have their own sorted lists of account ids; take the
+		// smallest id left among them each time round, so the merge needs no scratch space
+		int last = 0;
+		while (true) {
+			int next = 0;
+			for (auto it = range.first; it != range.second; ++it) {
+				auto ids = accounts_by_customer.find(it->second);
+				if (ids == accounts_by_customer.end())
+					continue;
+				auto after = std::upper_bound(ids->second.begin(), ids->second.end(), last);
+				if (after != ids->second.end() && (next == 0 || *after < next))
+					next = *after;
+			}
+			if (next == 0)
+				break;
+			last = next;
+
+			Account *acct = get_account(next);
+			{
+				auto account_lock = lock_account(next);
+				acct->render(out);
+			}
+			out.append("---------------------------\n");
+			count++;
+		}
+
+		char number[16];
+		out.append("Total ").append(number, std::to_chars(number, number + sizeof(number), count).ptr)
+			.append(" accounts found\n");
+		return count;
+	}
+
+	/**
+	Write what the instrumentation has collected so far: per-operation call and allocation
+	counts and latency percentiles.  Only a build with BANK_INSTRUMENT collects anything.
+	@param out The stream to write to
+	*/
+	void dump_instrumentation(std::ostream &out) const
+	{
+#ifdef BANK_INSTRUMENT
+		instrumentation.dump(out);
+#else
+		out << "Instrumentation is not compiled in; rebuild with BANK_INSTRUMENT defined.\n";
+#endif
+	}
+
+	/**
+	Get the account object for an account identified by an account id.
+	Runs in constant time and never locks: ids are sequential, so the id maps straight to a row in the store.
+	@param acct_name The account id
+	@return the account object if it exists, NULL otherwise
+	*/
+	Account *get_account(int acct_number) const
+	{
+		return store.account(row_of(acct_number));
+	}
+
+	/**
+	Find the store row an account id maps to
+	@param acct_number The account id
+	@return the row number.  Ids below the first account wrap around to a huge row and fail any bounds check.
+	*/
+	static size_t row_of(int acct_number)
+	{
+		return (size_t)((long long)acct_number - FIRST_ACCOUNT_ID - 1);
+	}
+};
+
+#endif
@@ -4,10 +4,13 @@
 *  Authors: Whitworth CS Department
 */
 
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <string>
 #include <vector>
 #include "Bank.h"
+#include "batch_driver.h"
 #include "readint.h"
 
 using namespace std;
@@ -90,15 +93,11 @@ void List_Account(Bank &bank)
 	cin.ignore();
 	getline(cin, name);
 
-	vector<int> list = bank.get_account(name);
-	cout << endl;
-	for (size_t i = 0; i < list.size(); i++) {
-		Account *acct = bank.get_account(list[i]);
-		if (acct)
-			cout << acct->to_string() ;
-		cout << "---------------------------\n";
-	}
-	cout << "Total " << list.size() << " accounts found\n";
+	// Reused from one listing to the next, so printing statements does not allocate
+	static string statement;
+	statement.clear();
+	bank.render_statement(name, statement);
+	cout << '\n' << statement;
 }
 
 /**
@@ -114,7 +113,7 @@ void Make_Deposit(Bank &bank)
 	double amt;
 	cout << "Amount to deposit: ";
 	cin >> amt;
-	bank.make_deposit(acct_id, amt);
+	bank.make_deposit(acct_id, Money::from_dollars(amt));
 }
 
 /** 
@@ -130,13 +129,44 @@ void Make_Withdrawal(Bank &bank)
 	double amt;
 	cout << "Amount to withdraw: ";
 	cin >> amt;
-	bank.make_withdrawal(acct_id, amt);
+	bank.make_withdrawal(acct_id, Money::from_dollars(amt));
 }
 
-int main()
+/**
+	Run commands from a file (or from stdin if no file is given) with no prompts.
+	See run_batch() for the command format.
+
+	@param bank Bank object to run the commands against
+	@param path The command file, or NULL for stdin
+	@return		The exit status
+*/
+int Run_Batch(Bank &bank, const char *path)
+{
+	// Nothing is interactive here, so let cout buffer freely
+	ios::sync_with_stdio(false);
+	cin.tie(NULL);
+	if (path == NULL) {
+		run_batch(cin, cout, bank);
+	} else {
+		ifstream in(path);
+		if (!in) {
+			cerr << "Cannot open " << path << endl;
+			return 1;
+		}
+		run_batch(in, cout, bank);
+	}
+	cout.flush();
+	return 0;
+}
+
+int main(int argc, char *argv[])
 {
 	Bank bank; // We create the bank
 
+	// Banking_Application --batch [file] replays a command file instead of showing the menu
+	if (argc > 1 && strcmp(argv[1], "--batch") == 0)
+		return Run_Batch(bank, argc > 2 ? argv[2] : NULL);
+
 	// Display menu for banking activites
 	cout << "Welcome to the CS273 Banking Application!\n";
 	cout << "Thank you for your hard work!\n";
@@ -0,0 +1,316 @@
+#ifndef COLUMNAR_EXPORT_H_
+#define COLUMNAR_EXPORT_H_
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Bank.h"
+
+/**
+Bulk export of a bank's accounts, customers and transactions in a simple columnar binary format,
+for analytics.
+
+The file starts with the 8 bytes "BANKCOLS" and a uint32 version, padded to 16 bytes, followed
+by any number of batches.  A batch holds a run of rows of one table, column by column:
+
+	uint32 table, uint32 column count, uint64 row count
+	for each column: uint64 byte length, then the bytes, padded to a multiple of 8
+
+Numbers are little-endian fixed-width arrays with one entry per row.  A string column takes
+two entries: uint32 offsets (row count + 1 of them) and then the characters.  Money is in cents.
+
+	Accounts (1)		account_number i32, customer_id i32, balance i64, type u8, tier u8
+	Customers (2)		customer_id i32, age i32, tier u8, name, address, telephone (strings)
+	Transactions (3)	account_number i32, timestamp i64, amount i64, customer_id i32, counterparty i32,
+						check_charge u16, overdraft_fee u16, type u8
+
+Nothing is formatted.  Account batches are the Account_Store blocks themselves: their columns
+go to the file straight from memory with writev.  Customers and transactions are gathered
+into reusable column buffers a batch at a time.
+*/
+class Columnar_Export
+{
+public:
+	enum Table : uint32_t
+	{
+		ACCOUNTS = 1,
+		CUSTOMERS = 2,
+		TRANSACTIONS = 3
+	};
+
+	static const uint32_t VERSION = 1;
+	static const size_t BATCH_ROWS = 1 << 16;	// Rows per customer or transaction batch
+
+	/**
+	What write() exported
+	*/
+	struct Export_Result
+	{
+		uint64_t accounts;
+		uint64_t customers;
+		uint64_t transactions;
+		uint64_t bytes;
+	};
+
+private:
+	/**
+	Collects pieces of a batch and writes them in one writev call.
+	The pieces are not copied, so they must stay put until flush().
+	*/
+	class Writer
+	{
+	private:
+		int fd;
+		std::vector<iovec> pieces;
+		std::vector<uint64_t> lengths;	// Backing for the length prefixes, sized once so pointers stay valid
+		uint64_t written = 0;
+
+		static constexpr char PADDING[8] = {};
+
+	public:
+		explicit Writer(int fd_) : fd(fd_)
+		{
+			lengths.reserve(64);	// More than any batch has columns
+		}
+
+		void add(const void *data, size_t bytes)
+		{
+			if (bytes > 0)
+				pieces.push_back(iovec{const_cast<void *>(data), bytes});
+		}
+
+		/**
+		Add a column: its length, its bytes and padding
+		*/
+		void column(const void *data, size_t bytes)
+		{
+			lengths.push_back(bytes);
+			add(&lengths.back(), sizeof(uint64_t));
+			add(data, bytes);
+			add(PADDING, (8 - bytes % 8) % 8);
+		}
+
+		void flush()
+		{
+			size_t first = 0;
+			while (first < pieces.size()) {
+				int count = (int)std::min(pieces.size() - first, (size_t)IOV_MAX);
+				ssize_t n = writev(fd, &pieces[first], count);
+				if (n < 0) {
+					if (errno == EINTR)
+						continue;
+					throw std::runtime_error(std::string("cannot write export: ") + std::strerror(errno));
+				}
+				written += (uint64_t)n;
+				// Skip what was written, which may end part way through a piece
+				while (n > 0 && (size_t)n >= pieces[first].iov_len)
+					n -= (ssize_t)pieces[first++].iov_len;
+				if (n > 0) {
+					pieces[first].iov_base = static_cast<char *>(pieces[first].iov_base) + n;
+					pieces[first].iov_len -= (size_t)n;
+				}
+			}
+			pieces.clear();
+			lengths.clear();
+		}
+
+		uint64_t bytes() const { return written; }
+	};
+
+	struct Batch_Header
+	{
+		uint32_t table;
+		uint32_t columns;
+		uint64_t rows;
+	};
+
+	/**
+	A string column being gathered: offsets and characters
+	*/
+	struct String_Column
+	{
+		std::vector<uint32_t> offsets;
+		std::string chars;
+
+		void clear()
+		{
+			offsets.assign(1, 0);
+			chars.clear();
+		}
+
+		void push_back(std::string_view text)
+		{
+			chars.append(text.data(), text.size());
+			offsets.push_back((uint32_t)chars.size());
+		}
+
+		void write(Writer &out) const
+		{
+			out.column(offsets.data(), offsets.size() * sizeof(uint32_t));
+			out.column(chars.data(), chars.size());
+		}
+	};
+
+	template <typename T>
+	static void write_column(Writer &out, const std::vector<T> &column)
+	{
+		out.column(column.data(), column.size() * sizeof(T));
+	}
+
+	static void write_accounts(const Bank &bank, Writer &out)
+	{
+		Batch_Header header;
+		for (size_t b = 0; b < bank.store.block_count(); b++) {
+			const Account_Store::Block &block = bank.store.block(b);
+			size_t rows = bank.store.block_size(b);
+			header = {ACCOUNTS, 5, rows};
+			out.add(&header, sizeof(header));
+			out.column(block.account_number, rows * sizeof(int));
+			out.column(block.customer_id, rows * sizeof(int));
+			out.column(block.balance, rows * sizeof(Money));
+			out.column(block.type, rows * sizeof(Account_Type));
+			out.column(block.tier, rows * sizeof(Customer_Tier));
+			out.flush();
+		}
+	}
+
+	static void write_customers(const Bank &bank, Writer &out)
+	{
+		std::vector<int32_t> ids, ages;
+		std::vector<Customer_Tier> tiers;
+		String_Column names, addresses, telephones;
+		Batch_Header header;
+
+		size_t next = 0;
+		while (next < bank.customers.size()) {
+			size_t end = std::min(next + BATCH_ROWS, bank.customers.size());
+			ids.clear();
+			ages.clear();
+			tiers.clear();
+			names.clear();
+			addresses.clear();
+			telephones.clear();
+			for (; next < end; next++) {
+				Customer *cust = bank.customers[next];
+				ids.push_back(cust->get_customer_id());
+				ages.push_back(cust->get_age());
+				tiers.push_back(cust->get_tier());
+				names.push_back(cust->get_name());
+				addresses.push_back(cust->get_address());
+				telephones.push_back(cust->get_telephone_number());
+			}
+			header = {CUSTOMERS, 9, ids.size()};
+			out.add(&header, sizeof(header));
+			write_column(out, ids);
+			write_column(out, ages);
+			write_column(out, tiers);
+			names.write(out);
+			addresses.write(out);
+			telephones.write(out);
+			out.flush();
+		}
+	}
+
+	static uint64_t write_transactions(const Bank &bank, Writer &out)
+	{
+		std::vector<int32_t> accounts, customers, counterparties;
+		std::vector<int64_t> timestamps, amounts;
+		std::vector<uint16_t> check_charges, overdraft_fees;
+		std::vector<Transaction_Type> types;
+		Batch_Header header;
+		uint64_t total = 0;
+
+		auto flush = [&]() {
+			if (accounts.empty())
+				return;
+			header = {TRANSACTIONS, 8, accounts.size()};
+			out.add(&header, sizeof(header));
+			write_column(out, accounts);
+			write_column(out, timestamps);
+			write_column(out, amounts);
+			write_column(out, customers);
+			write_column(out, counterparties);
+			write_column(out, check_charges);
+			write_column(out, overdraft_fees);
+			write_column(out, types);
+			out.flush();
+			total += accounts.size();
+			accounts.clear();
+			timestamps.clear();
+			amounts.clear();
+			customers.clear();
+			counterparties.clear();
+			check_charges.clear();
+			overdraft_fees.clear();
+			types.clear();
+		};
+
+		for (size_t row = 0; row < bank.store.size(); row++) {
+			Account *acct = bank.store.account(row);
+			int acct_number = acct->get_account();
+			for (const Transaction &tran : acct->get_transactions()) {
+				accounts.push_back(acct_number);
+				timestamps.push_back(tran.get_timestamp());
+				amounts.push_back(tran.get_amount().get_cents());
+				customers.push_back(tran.get_customer_number());
+				counterparties.push_back(tran.get_counterparty());
+				check_charges.push_back((uint16_t)tran.get_check_charge().get_cents());
+				overdraft_fees.push_back((uint16_t)tran.get_overdraft_fee().get_cents());
+				types.push_back(tran.get_type());
+				if (accounts.size() == BATCH_ROWS)
+					flush();
+			}
+		}
+		flush();
+		return total;
+	}
+
+public:
+	/**
+	Export a bank to a file.  A concurrent bank stays read-locked at the directory and locked
+	at all of its account stripes until the file is closed, so accounts can still be looked up
+	meanwhile, but nothing is posted and no account is opened.
+	@param bank The bank
+	@param path The file to write
+	@return how many rows and bytes were written
+	*/
+	static Export_Result write(const Bank &bank, const std::string &path)
+	{
+		auto directory = bank.read_directory();
+		auto locks = bank.lock_all_accounts();
+
+		int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0)
+			throw std::runtime_error("cannot create export " + path + ": " + std::strerror(errno));
+		Export_Result result = {};
+		try {
+			Writer out(fd);
+			char magic[16] = {'B', 'A', 'N', 'K', 'C', 'O', 'L', 'S'};
+			std::memcpy(magic + 8, &VERSION, sizeof(VERSION));
+			out.add(magic, sizeof(magic));
+			out.flush();
+
+			write_accounts(bank, out);
+			write_customers(bank, out);
+			result.transactions = write_transactions(bank, out);
+			result.accounts = bank.store.size();
+			result.customers = bank.customers.size();
+			result.bytes = out.bytes();
+		} catch (...) {
+			::close(fd);
+			throw;
+		}
+		if (::close(fd) != 0)
+			throw std::runtime_error("cannot write export " + path + ": " + std::strerror(errno));
+		return result;
+	}
+};
+
+#endif
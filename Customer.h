@@ -1,7 +1,14 @@
 #ifndef CUSTOMER_H_
 #define CUSTOMER_H_
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <sstream>
 #include <string>
+#include <string_view>
 #include <vector>
+#include "Money.h"
 
 using namespace std;
 
@@ -14,137 +21,252 @@ as well as its own checking and overdraft fees.
 @author: Ed Walker
 */
 
+/**
+The types (tiers) of customer.  The value indexes TIER_SCHEDULES.
+*/
+enum class Customer_Tier : uint8_t
+{
+    Adult,
+    Senior,
+    Student
+};
+
+/**
+Name of a customer tier, as used when opening accounts and shown in statements
+*/
+constexpr const char *customer_tier_name(Customer_Tier tier)
+{
+    return tier == Customer_Tier::Senior ? "senior" : tier == Customer_Tier::Student ? "student" : "adult";
+}
+
+/**
+The interest rates and fees for a tier of customer.  Every customer of a tier shares one schedule,
+so an account can look it up once and keep a pointer to it.
+*/
+struct Fee_Schedule
+{
+    Rate savings_interest;
+    Rate check_interest;
+    Money check_charge;
+    Money overdraft_penalty;
+};
+
+/**
+Compile-time schedule for each customer tier, in Customer_Tier order
+*/
+inline constexpr Fee_Schedule TIER_SCHEDULES[] = {
+    //savings interest      checking interest     check charge              overdraft penalty
+    {Rate::from_ppm(30000), Rate::from_ppm(30000), Money::from_cents(150), Money::from_cents(3500)},  // Adult
+    {Rate::from_ppm(50000), Rate::from_ppm(10000), Money::from_cents(200), Money::from_cents(2500)},  // Senior
+    {Rate::from_ppm(10000), Rate::from_ppm(50000), Money::from_cents(100), Money::from_cents(2500)},  // Student
+};
+
+/**
+Look up the schedule for a customer tier
+@param tier The customer tier
+@return the tier's interest rates and fees
+*/
+constexpr const Fee_Schedule &schedule_for(Customer_Tier tier)
+{
+    return TIER_SCHEDULES[(int)tier];
+}
+
+/**
+A description of a fee schedule for reports.  Nothing is formatted until the summary is
+written to a stream or str() is called, so producing one costs nothing on the posting path.
+*/
+class Fee_Summary
+{
+private:
+    const Fee_Schedule *fees;
+public:
+    Fee_Summary(const Fee_Schedule &fees_) : fees(&fees_) {}
+    
+    friend std::ostream &operator<<(std::ostream &out, const Fee_Summary &summary)
+    {
+        return out << "Check Charge: " << summary.fees->check_charge
+                   << " Overdraft Fee: " << summary.fees->overdraft_penalty;
+    }
+    
+    std::string str() const
+    {
+        std::stringstream ss;
+        ss << *this;
+        return ss.str();
+    }
+};
+
+class Customer;
+
+/**
+The text fields of a customer, which share one buffer
+*/
+enum class Customer_Field : uint8_t { Name, Address, Telephone };
+
+/**
+Something that indexes customers by name (i.e. the Bank) and must hear about changes to their text.
+Changing any text field can move the name, so a customer with a listener does not change its own
+text: it hands the change to text_changing, which makes it through rewrite() while holding
+whatever guards the index, so nobody reading the index sees the text half rewritten.
+*/
+class Customer_Listener
+{
+public:
+    virtual void text_changing(Customer *cust, Customer_Field field, std::string_view value) = 0;
+
+protected:
+    // Make the change to the customer's text
+    static void rewrite(Customer *cust, Customer_Field field, std::string_view value);
+};
+
 class Customer
 {
+public:
+    static const size_t INLINE_TEXT = 48;  // Bytes of text kept inside the record before it moves to the heap
+
 protected:
-    string name = "";
-    string address = "";
+    // The name, address and telephone number are kept back to back in one buffer: inside the
+    // record when they fit, which they usually do, or else in a single heap block.  Either way a
+    // customer costs one allocation at most instead of one per string, and the getters hand out views.
+    char *text;
+    uint32_t name_length = 0;
+    uint32_t address_length = 0;
+    uint32_t telephone_length = 0;
     int age = 0;
-    string telephone_number = "";
     int customer_number = 0;
-    string cust_type = "";
-    
-public:
-    //Constructor for Csutomer object
-    Customer(int customer_id, string cust_name, string customer_type){
+    Customer_Tier tier;
+    Customer_Listener *listener = NULL;  // Makes every change to the text, NULL if nobody is indexing us
+    char inline_text[INLINE_TEXT];
+
+    // The listener's rewrite() calls write_text
+    friend class Customer_Listener;
+
+    /**
+    Replace one of the text fields, repacking the buffer
+    @param field Which field
+    @param value The new text
+    */
+    void write_text(Customer_Field field, std::string_view value)
+    {
+        std::string_view parts[3] = {get_name(), get_address(), get_telephone_number()};
+        parts[(int)field] = value;
+        size_t total = parts[0].size() + parts[1].size() + parts[2].size();
+
+        // Build the new text somewhere the old text is not, as the value may point into it
+        char staging[INLINE_TEXT];
+        char *dest = total <= INLINE_TEXT ? (text == inline_text ? staging : inline_text) : new char[total];
+        char *at = dest;
+        for (std::string_view part : parts) {
+            std::memcpy(at, part.data(), part.size());
+            at += part.size();
+        }
+        if (dest == staging)
+            std::memcpy(inline_text, staging, total);
+        if (text != inline_text)
+            delete[] text;
+        text = dest == staging ? inline_text : dest;
+        name_length = (uint32_t)parts[0].size();
+        address_length = (uint32_t)parts[1].size();
+        telephone_length = (uint32_t)parts[2].size();
+    }
+
+    /**
+    Replace one of the text fields, through the listener if there is one
+    @param field Which field
+    @param value The new text
+    */
+    void set_text(Customer_Field field, std::string_view value)
+    {
+        if (listener)
+            listener->text_changing(this, field, value);
+        else
+            write_text(field, value);
+    }
+
+    //Constructor for Csutomer object, used by the tier subclasses
+    Customer(int customer_id, std::string_view cust_name, Customer_Tier tier_) : text(inline_text), tier(tier_) {
     
-        name = cust_name;
         customer_number = customer_id;
-        cust_type = customer_type;
+        set_text(Customer_Field::Name, cust_name);
     }
     
-    //Accessor and manipulator functions for variables in Customer class
-    int get_customer_id () {return customer_number;}
-    string get_name() {return name;}
-    string get_cust_type() {return cust_type;}
-    string get_address() {return address;}
-    string get_telephone_number() {return telephone_number;}
-    int get_age() {return age;}
-    void set_name(string name_)
+public:
+    virtual ~Customer()
     {
-        name = name_;
+        if (text != inline_text)
+            delete[] text;
     }
-    void set_address(string address_)
+
+    // The text buffer may point into the record itself, so customers are not copied
+    Customer(const Customer &) = delete;
+    Customer &operator=(const Customer &) = delete;
+    
+    //Accessor and manipulator functions for variables in Customer class; the text ones are views into the customer
+    int get_customer_id () const {return customer_number;}
+    std::string_view get_name() const {return std::string_view(text, name_length);}
+    std::string_view get_cust_type() const {return customer_tier_name(tier);}
+    std::string_view get_address() const {return std::string_view(text + name_length, address_length);}
+    std::string_view get_telephone_number() const {return std::string_view(text + name_length + address_length, telephone_length);}
+    int get_age() const {return age;}
+    void set_name(std::string_view name_)
     {
-        address = address_;
+        //set_text lets the index drop the old name and add the new one around the change
+        set_text(Customer_Field::Name, name_);
     }
-    void set_age(int age_)
+    void set_listener(Customer_Listener *listener_)
     {
-        age = age_;
+        listener = listener_;
     }
-    void set_telephone_number(string telephone_number_)
+    void set_address(std::string_view address_)
+    {
+        set_text(Customer_Field::Address, address_);
+    }
+    void set_age(int age_)
     {
-        telephone_number = telephone_number_;
+        age = age_;
     }
-    void set_cust_type(string cust_type_)
+    void set_telephone_number(std::string_view telephone_number_)
     {
-        cust_type = cust_type_;
+        set_text(Customer_Field::Telephone, telephone_number_);
     }
     void set_customer_id(int customer_number_)
     {
         customer_number = customer_number_; 
     }
-    //Virtual functions to get the data from the subclasses
-    virtual const double get_overdraft_penalty() = 0;
-    virtual const double get_check_charge() = 0;
-    virtual const double get_savings_interest() = 0;
-    virtual const double get_check_interest() = 0;
+    //Interest rates and fees come from the tier's compile-time schedule, so these inline to a table load
+    Customer_Tier get_tier() const {return tier;}
+    const Fee_Schedule &get_fee_schedule() const {return schedule_for(tier);}
+    Money get_overdraft_penalty() const {return get_fee_schedule().overdraft_penalty;}
+    Money get_check_charge() const {return get_fee_schedule().check_charge;}
+    Rate get_savings_interest() const {return get_fee_schedule().savings_interest;}
+    Rate get_check_interest() const {return get_fee_schedule().check_interest;}
 
 };
 
+inline void Customer_Listener::rewrite(Customer *cust, Customer_Field field, std::string_view value)
+{
+    cust->write_text(field, value);
+}
+
 //Students IS-A Customer
 class Student: public Customer{
 public:
     //Constructor for Customer object of type Student
-    Student(int customer_id, string cust_name, string customer_type): Customer(customer_id, cust_name, customer_type){};
-    //Set the values of the interest and fees
-    const double SAVINGS_INTEREST = 0.01;
-    const double CHECK_INTEREST = 0.05;
-    const double CHECK_CHARGE = 1.00;
-    const double OVERDRAFT_PENALTY = 25.00;
-    //Accessor functions for the interest and fees specific to each subclass
-    const double get_overdraft_penalty (){
-        return OVERDRAFT_PENALTY;
-    }
-    const double get_check_charge(){
-        return CHECK_CHARGE;
-    }
-    const double get_savings_interest(){
-        return SAVINGS_INTEREST;
-    }
-    const double get_check_interest(){
-        return CHECK_INTEREST;
-    }
+    Student(int customer_id, std::string_view cust_name): Customer(customer_id, cust_name, Customer_Tier::Student){};
 };
 
 //Senior IS-A Customer
 class Senior: public Customer{
 public:
     //Constructor for Customer object of type Senior
-    Senior(int customer_id, string cust_name, string customer_type): Customer(customer_id, cust_name, customer_type){};
-    //Set the values of the interest and fees
-    const double SAVINGS_INTEREST = 0.05;
-    const double CHECK_INTEREST = 0.01;
-    const double CHECK_CHARGE = 2.00;
-    const double OVERDRAFT_PENALTY = 25.00;
-    //Accessor functions for the interest and fees specific to each subclass
-    const double get_overdraft_penalty (){
-        return OVERDRAFT_PENALTY;
-    }
-    const double get_check_charge(){
-        return CHECK_CHARGE;
-    }
-    const double get_savings_interest(){
-        return SAVINGS_INTEREST;
-    }
-    const double get_check_interest(){
-        return CHECK_INTEREST;
-    }
+    Senior(int customer_id, std::string_view cust_name): Customer(customer_id, cust_name, Customer_Tier::Senior){};
 };
 
 //Adult IS-A Customer
 class Adult: public Customer{
 public:
     //Constructor for Customer object of type Adult
-    Adult(int customer_id, string cust_name, string customer_type): Customer(customer_id, cust_name, customer_type){};
-    //Set the values of the interest and fees
-    const double SAVINGS_INTEREST = 0.03;
-    const double CHECK_INTEREST = 0.03;
-    const double CHECK_CHARGE = 1.50;
-    const double OVERDRAFT_PENALTY = 35.00;
-    //Accessor functions for the interest and fees specific to each subclass
-    const double get_overdraft_penalty (){
-        return OVERDRAFT_PENALTY;
-    }
-    const double get_check_charge(){
-        return CHECK_CHARGE;
-    }
-    const double get_savings_interest(){
-        return SAVINGS_INTEREST;
-    }
-    const double get_check_interest(){
-        return CHECK_INTEREST;
-    }
+    Adult(int customer_id, std::string_view cust_name): Customer(customer_id, cust_name, Customer_Tier::Adult){};
 };
 
 #endif
@@ -0,0 +1,50 @@
+#include <cstdlib>
+#include <new>
+#include "Instrumentation.h"
+
+/*
+	Counts heap allocations per thread for the Bank's probes (see Instrumentation.h) by
+	replacing the global operator new.  Link this file into a program built with BANK_INSTRUMENT
+	to get allocation counts; without BANK_INSTRUMENT it is empty.
+*/
+
+#ifdef BANK_INSTRUMENT
+
+void *operator new(std::size_t size)
+{
+	thread_allocations++;
+	if (void *p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, std::align_val_t align)
+{
+	thread_allocations++;
+	size_t alignment = (size_t)align;
+	if (void *p = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept
+{
+	std::free(p);
+}
+
+#endif
@@ -0,0 +1,243 @@
+#ifndef INSTRUMENTATION_H_
+#define INSTRUMENTATION_H_
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+/**
+Optional counters, latency histograms and allocation counts for the Bank's hot paths.
+
+The probes are compiled in only when BANK_INSTRUMENT is defined (cmake -DHW5_INSTRUMENT=ON,
+or -DBANK_INSTRUMENT by hand).  Otherwise BANK_PROBE expands to nothing, so an uninstrumented
+build carries no clock reads, counters or extra members.  Latency_Histogram is always
+available, for programs that time the Bank from outside (load_generator.cpp).
+
+Each probed Bank operation counts one call, adds its latency (from entry to return, lock waits
+included) to a histogram, and counts the heap allocations made on the calling thread while it ran.
+Allocations are counted by the replacement operator new in Instrumentation.cpp; a program
+that does not link that file reports them as 0.
+*/
+
+/**
+The operations that are probed
+*/
+enum class Bank_Op : uint8_t
+{
+	Deposit,			// Bank::make_deposit
+	Withdrawal,			// Bank::make_withdrawal
+	Transfer,			// Bank::transfer, one at a time
+	Transfer_Batch,		// Bank::transfer(requests), one call for the whole batch
+	Open_Account,		// Bank::add_account(name, type), for an existing customer
+	Onboard_Customer,	// Bank::add_account(name, address, ...), for a new customer
+	Open_Batch,			// Bank::add_accounts, one call for the whole batch
+	Name_Lookup,		// Bank::get_account(name)
+	Statement,			// Bank::render_statement
+	Interest_Run		// Bank::accrue_interest
+};
+
+const int BANK_OPS = 10;
+
+/**
+Name of a probed operation, as shown in reports
+*/
+inline const char *bank_op_name(Bank_Op op)
+{
+	static const char *const NAMES[BANK_OPS] = {"deposit", "withdrawal", "transfer", "transfer_batch",
+			"open_account", "onboard_customer", "open_batch", "name_lookup", "statement", "interest_run"};
+	return NAMES[(int)op];
+}
+
+/**
+A latency histogram in the style of HdrHistogram: buckets are exact below 2^SUB_BITS ns, and
+above that each power of two is split into 2^SUB_BITS equal buckets, so any recorded value
+is known to within about 3% whatever its size.  Recording takes a few relaxed atomic
+operations and no lock, so any number of threads can record at once.
+*/
+class Latency_Histogram
+{
+public:
+	static const int SUB_BITS = 5;
+	static const int MAX_BITS = 40;		// Values up to 2^40 ns (18 minutes); longer ones land in the last bucket
+
+private:
+	static const uint64_t SUB = 1u << SUB_BITS;
+	static const int BUCKETS = (MAX_BITS - SUB_BITS + 1) * (int)SUB;
+
+	std::atomic<uint64_t> counts[BUCKETS] = {};
+	std::atomic<uint64_t> total{0};
+	std::atomic<uint64_t> sum{0};
+	std::atomic<uint64_t> largest{0};
+
+	static int bucket_of(uint64_t ns)
+	{
+		if (ns < SUB)
+			return (int)ns;
+		int top = 63 - __builtin_clzll(ns);
+		if (top >= MAX_BITS)
+			return BUCKETS - 1;
+		int shift = top - SUB_BITS;
+		return (shift + 1) * (int)SUB + (int)((ns >> shift) - SUB);
+	}
+
+	/**
+	@return the largest value that falls in a bucket
+	*/
+	static uint64_t highest_in(int bucket)
+	{
+		if (bucket < (int)SUB)
+			return (uint64_t)bucket;
+		int shift = bucket / (int)SUB - 1;
+		uint64_t low = (SUB + (uint64_t)(bucket % (int)SUB)) << shift;
+		return low + ((uint64_t)1 << shift) - 1;
+	}
+
+public:
+	void record(uint64_t ns)
+	{
+		counts[bucket_of(ns)].fetch_add(1, std::memory_order_relaxed);
+		total.fetch_add(1, std::memory_order_relaxed);
+		sum.fetch_add(ns, std::memory_order_relaxed);
+		uint64_t seen = largest.load(std::memory_order_relaxed);
+		while (ns > seen && !largest.compare_exchange_weak(seen, ns, std::memory_order_relaxed))
+			;
+	}
+
+	/**
+	Add in everything another histogram has recorded, e.g. to combine per-thread histograms
+	@param other The histogram to add
+	*/
+	void merge(const Latency_Histogram &other)
+	{
+		for (int b = 0; b < BUCKETS; b++)
+			counts[b].fetch_add(other.counts[b].load(std::memory_order_relaxed), std::memory_order_relaxed);
+		total.fetch_add(other.count(), std::memory_order_relaxed);
+		sum.fetch_add(other.sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		uint64_t theirs = other.max();
+		uint64_t seen = largest.load(std::memory_order_relaxed);
+		while (theirs > seen && !largest.compare_exchange_weak(seen, theirs, std::memory_order_relaxed))
+			;
+	}
+
+	uint64_t count() const { return total.load(std::memory_order_relaxed); }
+	uint64_t max() const { return largest.load(std::memory_order_relaxed); }
+
+	double mean() const
+	{
+		uint64_t n = count();
+		return n ? (double)sum.load(std::memory_order_relaxed) / (double)n : 0.0;
+	}
+
+	/**
+	@param fraction	e.g. 0.99 for the 99th percentile
+	@return the value that fraction of the recorded values are at or below, to within a bucket
+	*/
+	uint64_t percentile(double fraction) const
+	{
+		uint64_t n = count();
+		if (n == 0)
+			return 0;
+		uint64_t rank = (uint64_t)(fraction * (double)n + 0.5);
+		if (rank < 1)
+			rank = 1;
+		uint64_t seen = 0;
+		for (int b = 0; b < BUCKETS; b++) {
+			seen += counts[b].load(std::memory_order_relaxed);
+			if (seen >= rank)
+				return std::min(highest_in(b), max());
+		}
+		return max();
+	}
+};
+
+#ifdef BANK_INSTRUMENT
+#include <chrono>
+#include <iomanip>
+
+// Heap allocations made so far on this thread, counted by the operator new in Instrumentation.cpp
+inline thread_local uint64_t thread_allocations = 0;
+
+/**
+What the probes of one Bank have collected
+*/
+class Bank_Instrumentation
+{
+private:
+	struct Op_Stats
+	{
+		Latency_Histogram latency;
+		std::atomic<uint64_t> allocations{0};
+	};
+
+	Op_Stats ops[BANK_OPS];
+
+public:
+	/**
+	Times one operation from construction to destruction, and counts its allocations
+	*/
+	class Probe
+	{
+	private:
+		Op_Stats &stats;
+		uint64_t allocations_before;
+		std::chrono::steady_clock::time_point start;
+
+	public:
+		Probe(Bank_Instrumentation &owner, Bank_Op op)
+			: stats(owner.ops[(int)op]), allocations_before(thread_allocations), start(std::chrono::steady_clock::now())
+		{
+		}
+
+		~Probe()
+		{
+			auto elapsed = std::chrono::steady_clock::now() - start;
+			stats.latency.record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+			stats.allocations.fetch_add(thread_allocations - allocations_before, std::memory_order_relaxed);
+		}
+
+		Probe(const Probe &) = delete;
+		Probe &operator=(const Probe &) = delete;
+	};
+
+	/**
+	Write a table of every operation that has been called: calls, allocations, and latency
+	percentiles in nanoseconds
+	@param out The stream to write to
+	*/
+	void dump(std::ostream &out) const
+	{
+		std::ios::fmtflags flags = out.flags();
+		std::streamsize precision = out.precision();
+		out << std::left << std::setw(18) << "operation" << std::right
+			<< std::setw(12) << "calls" << std::setw(14) << "allocations" << std::setw(11) << "allocs/op"
+			<< std::setw(11) << "mean ns" << std::setw(11) << "p50" << std::setw(11) << "p90"
+			<< std::setw(11) << "p99" << std::setw(11) << "p99.9" << std::setw(13) << "max" << '\n';
+		for (int i = 0; i < BANK_OPS; i++) {
+			const Op_Stats &op = ops[i];
+			uint64_t calls = op.latency.count();
+			if (calls == 0)
+				continue;
+			uint64_t allocs = op.allocations.load(std::memory_order_relaxed);
+			out << std::left << std::setw(18) << bank_op_name((Bank_Op)i) << std::right
+				<< std::setw(12) << calls << std::setw(14) << allocs
+				<< std::setw(11) << std::fixed << std::setprecision(2) << (double)allocs / (double)calls
+				<< std::setw(11) << std::setprecision(0) << op.latency.mean()
+				<< std::setw(11) << op.latency.percentile(0.50) << std::setw(11) << op.latency.percentile(0.90)
+				<< std::setw(11) << op.latency.percentile(0.99) << std::setw(11) << op.latency.percentile(0.999)
+				<< std::setw(13) << op.latency.max() << '\n';
+		}
+		out.flags(flags);
+		out.precision(precision);
+	}
+};
+
+// Probe the rest of the enclosing scope as one call of op
+#define BANK_PROBE(op) Bank_Instrumentation::Probe bank_probe_(instrumentation, op)
+
+#else
+
+#define BANK_PROBE(op)
+
+#endif
+
+#endif
@@ -0,0 +1,393 @@
+#ifndef JOURNAL_H_
+#define JOURNAL_H_
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Transaction.h"
+
+/**
+One posting as stored in the journal: the account it was posted to and its transaction record
+*/
+struct Journal_Record
+{
+	uint64_t sequence;	// Position in the journal, starting at 0; a record is only valid in its own slot
+	int32_t account;	// The account the posting was made to
+	uint32_t checksum;	// Over the rest of the record, to tell a finished record from a torn one
+	Transaction tran;
+
+	/**
+	@return the checksum this record should carry
+	*/
+	uint32_t compute_checksum() const
+	{
+		// FNV-1a over every field but the checksum itself, one field at a time: tran has
+		// padding, and whatever bytes a copy leaves there must not count
+		uint32_t hash = 2166136261u;
+		auto mix = [&hash](const void *field, size_t size) {
+			const unsigned char *bytes = static_cast<const unsigned char *>(field);
+			for (size_t i = 0; i < size; i++)
+				hash = (hash ^ bytes[i]) * 16777619u;
+		};
+		int64_t timestamp = tran.get_timestamp();
+		int64_t amount = tran.get_amount().get_cents();
+		int32_t customer = tran.get_customer_number();
+		int32_t counterparty = tran.get_counterparty();
+		int64_t check_charge = tran.get_check_charge().get_cents();
+		int64_t overdraft_fee = tran.get_overdraft_fee().get_cents();
+		Transaction_Type type = tran.get_type();
+		mix(&sequence, sizeof(sequence));
+		mix(&account, sizeof(account));
+		mix(&timestamp, sizeof(timestamp));
+		mix(&amount, sizeof(amount));
+		mix(&customer, sizeof(customer));
+		mix(&counterparty, sizeof(counterparty));
+		mix(&check_charge, sizeof(check_charge));
+		mix(&overdraft_fee, sizeof(overdraft_fee));
+		mix(&type, sizeof(type));
+		return hash;
+	}
+};
+
+static_assert(sizeof(Journal_Record) == 48, "journal records are meant to stay 48 bytes");
+
+/**
+An append-only, durable log of every posting, kept in fixed-size binary records.
+
+The journal is a numbered series of segment files (<path>.0, <path>.1, ...), each a 64-byte
+header followed by room for SEGMENT_RECORDS records.  A segment is created at full size and
+memory-mapped, so appending a posting is a copy into the mapping under a short lock, with no
+system call.  Durability comes from commit(), which msyncs everything appended since the last
+commit in one go; a background thread can do this every few milliseconds (group commit), so a
+burst of postings shares one flush.  After a crash, reading stops at the first slot whose
+sequence number or checksum does not match, which is where the journal picks up again when reopened.
+*/
+class Journal
+{
+public:
+	static const size_t SEGMENT_RECORDS = 1 << 20;	// 48 MB of records per segment
+	static const size_t HEADER_SIZE = 64;
+
+private:
+	static constexpr char MAGIC[8] = {'B', 'A', 'N', 'K', 'J', 'R', 'N', 'L'};
+	static const uint32_t VERSION = 2;	// 2: checksums cover the fields, not the padding
+
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t record_size;
+		uint64_t first_sequence;
+	};
+
+	/**
+	One mapped segment file
+	*/
+	struct Segment
+	{
+		char *base = NULL;		// The mapping, header included
+		uint64_t first = 0;		// Sequence number of the first record slot
+		uint64_t synced = 0;	// Records from first up to here have been flushed
+
+		Journal_Record *records() const { return reinterpret_cast<Journal_Record *>(base + HEADER_SIZE); }
+	};
+
+	std::string path;
+	std::mutex lock;			// Guards appends, current and retired
+	std::mutex commit_lock;		// One commit at a time
+	Segment current;
+	std::vector<Segment> retired;	// Full segments that have not been flushed and unmapped yet
+	uint64_t next = 0;				// Sequence number of the next record
+
+	std::thread committer;			// Background group commit, if any
+	std::condition_variable stop_signal;
+	bool stopping = false;
+
+	static size_t segment_bytes()
+	{
+		return HEADER_SIZE + SEGMENT_RECORDS * sizeof(Journal_Record);
+	}
+
+	static std::string segment_path(const std::string &path, uint64_t number)
+	{
+		return path + "." + std::to_string(number);
+	}
+
+	[[noreturn]] static void fail(const std::string &what)
+	{
+		throw std::runtime_error(what + ": " + std::strerror(errno));
+	}
+
+	/**
+	Map a segment file, creating it at full size if asked
+	@param path		The journal's base path
+	@param number	The segment number
+	@param create	Create the file if it does not exist
+	@return the mapping, or NULL if the file does not exist and create is false
+	*/
+	static char *map_segment(const std::string &path, uint64_t number, bool create)
+	{
+		std::string name = segment_path(path, number);
+		int fd = ::open(name.c_str(), create ? O_RDWR | O_CREAT : O_RDWR, 0644);
+		if (fd < 0) {
+			if (!create && errno == ENOENT)
+				return NULL;
+			fail("cannot open journal segment " + name);
+		}
+		struct stat st;
+		if (fstat(fd, &st) != 0) {
+			::close(fd);
+			fail("cannot stat journal segment " + name);
+		}
+		bool fresh = (size_t)st.st_size < HEADER_SIZE;
+		if ((size_t)st.st_size != segment_bytes() && ftruncate(fd, segment_bytes()) != 0) {
+			::close(fd);
+			fail("cannot size journal segment " + name);
+		}
+		void *base = mmap(NULL, segment_bytes(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (base == MAP_FAILED)
+			fail("cannot map journal segment " + name);
+
+		Header *header = static_cast<Header *>(base);
+		if (fresh) {
+			std::memcpy(header->magic, MAGIC, sizeof(MAGIC));
+			header->version = VERSION;
+			header->record_size = sizeof(Journal_Record);
+			header->first_sequence = number * SEGMENT_RECORDS;
+		} else if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION
+				|| header->record_size != sizeof(Journal_Record)) {
+			munmap(base, segment_bytes());
+			throw std::runtime_error("not a journal segment: " + name);
+		}
+		return static_cast<char *>(base);
+	}
+
+	/**
+	Flush part of a segment to disk
+	@param segment	The segment
+	@param from		First sequence number to flush
+	@param to		One past the last sequence number to flush
+	*/
+	static void sync(const Segment &segment, uint64_t from, uint64_t to)
+	{
+		if (from >= to)
+			return;
+		// msync wants a page-aligned start
+		size_t page = (size_t)sysconf(_SC_PAGESIZE);
+		size_t start = HEADER_SIZE + (from - segment.first) * sizeof(Journal_Record);
+		size_t end = HEADER_SIZE + (to - segment.first) * sizeof(Journal_Record);
+		start -= start % page;
+		if (msync(segment.base + start, end - start, MS_SYNC) != 0)
+			fail("cannot flush journal");
+	}
+
+	/**
+	Make room for the next record, moving on to a new segment when the current one is full.
+	Called with lock held.
+	*/
+	void roll()
+	{
+		uint64_t number = next / SEGMENT_RECORDS;
+		if (current.base)
+			retired.push_back(current);
+		current.base = map_segment(path, number, true);
+		current.first = number * SEGMENT_RECORDS;
+		current.synced = next;
+	}
+
+	/**
+	Copy a record into its slot.  Called with lock held.
+	*/
+	void put(int account, const Transaction &tran)
+	{
+		if (current.base == NULL || next == current.first + SEGMENT_RECORDS)
+			roll();
+		Journal_Record record{next, account, 0, tran};
+		record.checksum = record.compute_checksum();
+		std::memcpy(&current.records()[next - current.first], &record, sizeof(record));
+		next++;
+	}
+
+public:
+	/**
+	Open a journal, continuing after the last complete record if it already exists
+	@param path_				Base path of the segment files
+	@param commit_interval_ms	How often to commit in the background, or 0 to leave commits to the caller
+	*/
+	explicit Journal(const std::string &path_, unsigned commit_interval_ms = 0) : path(path_)
+	{
+		// Find the last segment, then the first slot in it that does not hold a good record
+		uint64_t number = 0;
+		char *base;
+		while ((base = map_segment(path, number, false)) != NULL) {
+			if (current.base)
+				munmap(current.base, segment_bytes());
+			current.base = base;
+			current.first = number * SEGMENT_RECORDS;
+			number++;
+		}
+		if (current.base) {
+			next = current.first;
+			const Journal_Record *records = current.records();
+			while (next < current.first + SEGMENT_RECORDS) {
+				const Journal_Record &record = records[next - current.first];
+				if (record.sequence != next || record.checksum != record.compute_checksum())
+					break;
+				next++;
+			}
+			current.synced = next;
+		}
+
+		if (commit_interval_ms > 0)
+			committer = std::thread([this, commit_interval_ms]() {
+				std::unique_lock<std::mutex> guard(commit_lock);
+				while (!stop_signal.wait_for(guard, std::chrono::milliseconds(commit_interval_ms),
+						[this]() { return stopping; })) {
+					guard.unlock();
+					commit();
+					guard.lock();
+				}
+			});
+	}
+
+	/**
+	Commit everything appended, then close the journal
+	*/
+	~Journal()
+	{
+		if (committer.joinable()) {
+			{
+				std::lock_guard<std::mutex> guard(commit_lock);
+				stopping = true;
+			}
+			stop_signal.notify_one();
+			committer.join();
+		}
+		commit();
+		if (current.base)
+			munmap(current.base, segment_bytes());
+	}
+
+	Journal(const Journal &) = delete;
+	Journal &operator=(const Journal &) = delete;
+
+	/**
+	Append one posting.  Safe to call from any number of threads.
+	It is durable once a later commit() returns.
+	@param account	The account the posting was made to
+	@param tran		The transaction record
+	*/
+	void append(int account, const Transaction &tran)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		put(account, tran);
+	}
+
+	/**
+	Append a run of postings to one account under a single lock
+	@param account	The account the postings were made to
+	@param first	The first transaction record
+	@param n		How many records
+	*/
+	void append(int account, const Transaction *first, size_t n)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		for (size_t i = 0; i < n; i++)
+			put(account, first[i]);
+	}
+
+	/**
+	Flush every record appended so far to disk.  Appends carry on while the flush runs.
+	*/
+	void commit()
+	{
+		std::lock_guard<std::mutex> committing(commit_lock);
+		std::vector<Segment> full;
+		Segment segment;
+		uint64_t to;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			full.swap(retired);
+			segment = current;
+			to = next;
+		}
+		for (Segment &old : full) {
+			sync(old, old.synced, old.first + SEGMENT_RECORDS);
+			munmap(old.base, segment_bytes());
+		}
+		if (segment.base) {
+			sync(segment, segment.synced, to);
+			std::lock_guard<std::mutex> guard(lock);
+			if (current.base == segment.base)
+				current.synced = to;
+		}
+	}
+
+	/**
+	@return the sequence number the next record will get, i.e. how many records the journal holds
+	*/
+	uint64_t size()
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		return next;
+	}
+
+	/**
+	Read the records of a journal in order, starting from a given sequence number.
+	Stops at the end of the journal or at the first incomplete record.
+	@param path	Base path of the segment files
+	@param from	Sequence number of the first record wanted
+	@param fn	Called as fn(const Journal_Record &) for each record
+	@return the sequence number after the last record read
+	*/
+	template <typename F>
+	static uint64_t read(const std::string &path, uint64_t from, F fn)
+	{
+		uint64_t seq = from;
+		while (true) {
+			uint64_t number = seq / SEGMENT_RECORDS;
+			std::string name = segment_path(path, number);
+			int fd = ::open(name.c_str(), O_RDONLY);
+			if (fd < 0) {
+				if (errno == ENOENT)
+					return seq;
+				fail("cannot open journal segment " + name);
+			}
+			void *base = mmap(NULL, segment_bytes(), PROT_READ, MAP_SHARED, fd, 0);
+			::close(fd);
+			if (base == MAP_FAILED)
+				fail("cannot map journal segment " + name);
+			madvise(base, segment_bytes(), MADV_SEQUENTIAL);
+
+			const Journal_Record *records =
+					reinterpret_cast<const Journal_Record *>(static_cast<char *>(base) + HEADER_SIZE);
+			uint64_t first = number * SEGMENT_RECORDS;
+			bool complete = true;
+			for (; seq < first + SEGMENT_RECORDS; seq++) {
+				const Journal_Record &record = records[seq - first];
+				if (record.sequence != seq || record.checksum != record.compute_checksum()) {
+					complete = false;
+					break;
+				}
+				fn(record);
+			}
+			munmap(base, segment_bytes());
+			if (!complete)
+				return seq;
+		}
+	}
+};
+
+#endif
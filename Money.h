@@ -0,0 +1,171 @@
+#ifndef MONEY_H_
+#define MONEY_H_
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+/**
+An interest rate, stored as a whole number of parts per million (10000 ppm = 1%).
+Keeping rates as integers means interest is calculated exactly, with one defined rounding step.
+*/
+class Rate
+{
+private:
+	int64_t ppm;
+
+public:
+	static const int64_t PPM = 1000000;
+
+	constexpr Rate() : ppm(0) {}
+
+	/**
+	@param ppm The rate in parts per million
+	*/
+	static constexpr Rate from_ppm(int64_t ppm)
+	{
+		Rate r;
+		r.ppm = ppm;
+		return r;
+	}
+
+	constexpr int64_t get_ppm() const { return ppm; }
+	double to_double() const { return (double)ppm / PPM; }
+
+	constexpr bool operator==(Rate other) const { return ppm == other.ppm; }
+	constexpr bool operator!=(Rate other) const { return ppm != other.ppm; }
+
+	static const size_t MAX_CHARS = 28;	// Longest text format() can produce
+
+	/**
+	Write the rate as a plain decimal fraction, e.g. 0.05, without allocating
+	@param out Where to write; room for MAX_CHARS characters
+	@return one past the last character written
+	*/
+	char *format(char *out) const
+	{
+		uint64_t mag = ppm < 0 ? 0 - (uint64_t)ppm : (uint64_t)ppm;
+		if (ppm < 0)
+			*out++ = '-';
+		out = std::to_chars(out, out + MAX_CHARS, mag / PPM).ptr;
+		uint64_t frac = mag % PPM;
+		if (frac) {
+			// Up to six digits, without the trailing zeros
+			int len = 6;
+			while (frac % 10 == 0) {
+				frac /= 10;
+				len--;
+			}
+			*out++ = '.';
+			for (int i = len - 1; i >= 0; i--, frac /= 10)
+				out[i] = (char)('0' + frac % 10);
+			out += len;
+		}
+		return out;
+	}
+
+	/**
+	Print the rate as a plain decimal fraction, e.g. 0.05
+	*/
+	friend std::ostream &operator<<(std::ostream &out, Rate rate)
+	{
+		char text[MAX_CHARS];
+		return out.write(text, rate.format(text) - text);
+	}
+};
+
+/**
+An amount of money, stored as a whole number of cents.
+
+All balances, transaction amounts and fees use this type, so postings add and subtract
+exactly and never need re-rounding.  The only rounding happens when interest is applied
+(see times()).  A Money is a single int64, so it can also be updated with integer atomics.
+*/
+class Money
+{
+private:
+	int64_t cents;
+
+public:
+	constexpr Money() : cents(0) {}
+
+	/**
+	@param cents The amount in cents
+	*/
+	static constexpr Money from_cents(int64_t cents)
+	{
+		Money m;
+		m.cents = cents;
+		return m;
+	}
+
+	/**
+	Convert a dollar amount (e.g. typed in by a user) to money, rounding to the nearest cent
+	@param dollars The amount in dollars
+	*/
+	static Money from_dollars(double dollars)
+	{
+		return from_cents(std::llround(dollars * 100));
+	}
+
+	constexpr int64_t get_cents() const { return cents; }
+	double to_dollars() const { return cents / 100.0; }
+
+	/**
+	Apply a rate to this amount, e.g. to work out interest.
+	The exact result is rounded to the nearest cent, with halves rounded away from zero.
+	Exact as long as |cents * ppm| fits in 63 bits (balances up to about $92 billion at 100%).
+	@param rate The rate
+	@return this amount times the rate
+	*/
+	constexpr Money times(Rate rate) const
+	{
+		int64_t product = cents * rate.get_ppm();
+		int64_t half = Rate::PPM / 2;
+		return from_cents((product >= 0 ? product + half : product - half) / Rate::PPM);
+	}
+
+	constexpr Money operator+(Money other) const { return from_cents(cents + other.cents); }
+	constexpr Money operator-(Money other) const { return from_cents(cents - other.cents); }
+	constexpr Money operator-() const { return from_cents(-cents); }
+	Money &operator+=(Money other) { cents += other.cents; return *this; }
+	Money &operator-=(Money other) { cents -= other.cents; return *this; }
+
+	constexpr bool operator==(Money other) const { return cents == other.cents; }
+	constexpr bool operator!=(Money other) const { return cents != other.cents; }
+	constexpr bool operator<(Money other) const { return cents < other.cents; }
+	constexpr bool operator<=(Money other) const { return cents <= other.cents; }
+	constexpr bool operator>(Money other) const { return cents > other.cents; }
+	constexpr bool operator>=(Money other) const { return cents >= other.cents; }
+
+	static const size_t MAX_CHARS = 24;	// Longest text format() can produce
+
+	/**
+	Write the amount in dollars with two decimals, e.g. 12.50 or -0.05, without allocating
+	@param out Where to write; room for MAX_CHARS characters
+	@return one past the last character written
+	*/
+	char *format(char *out) const
+	{
+		uint64_t c = cents < 0 ? 0 - (uint64_t)cents : (uint64_t)cents;
+		if (cents < 0)
+			*out++ = '-';
+		out = std::to_chars(out, out + MAX_CHARS, c / 100).ptr;
+		*out++ = '.';
+		*out++ = (char)('0' + c % 100 / 10);
+		*out++ = (char)('0' + c % 10);
+		return out;
+	}
+
+	/**
+	Print the amount in dollars with two decimals, e.g. 12.50 or -0.05
+	*/
+	friend std::ostream &operator<<(std::ostream &out, Money money)
+	{
+		char text[MAX_CHARS];
+		return out.write(text, money.format(text) - text);
+	}
+};
+
+#endif
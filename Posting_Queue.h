@@ -0,0 +1,136 @@
+#ifndef POSTING_QUEUE_H_
+#define POSTING_QUEUE_H_
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include "Money.h"
+
+/**
+A posting addressed to one account, as queued for the shard that owns it
+*/
+struct Posting
+{
+	enum class Kind : uint8_t
+	{
+		Deposit,
+		Withdrawal,
+		Transfer_Debit,		// First half of a transfer: take the money from account, then credit counterparty
+		Transfer_Credit		// Second half of a transfer: give the money to account, sent by counterparty
+	};
+
+	Kind kind;
+	int account;		// The account to post to
+	int counterparty;	// For transfers, the account on the other side
+	Money amount;
+	int64_t when;		// For transfers, the time of the debit, shared by both legs
+};
+
+/**
+A bounded, lock-free queue of postings with any number of producers and a single consumer.
+
+The queue is a ring of cells, each stamped with a sequence number that says whose turn it
+is: a producer claims the next position with one compare-and-swap on the tail, fills the
+cell and then bumps its sequence to hand it to the consumer; the consumer reads cells in
+order and bumps the sequence again to hand them back to producers one lap later.  Producers
+never wait for each other beyond retrying the CAS, and the consumer takes no atomic
+read-modify-write at all.  The ring is allocated once, so pushing never allocates.
+*/
+class Posting_Queue
+{
+private:
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		Posting posting;
+	};
+
+	std::unique_ptr<Cell[]> cells;
+	size_t mask;							// Capacity - 1; the capacity is a power of two
+	alignas(64) std::atomic<size_t> tail;	// Next position producers will claim
+	alignas(64) size_t head = 0;			// Next position the consumer will read; consumer only
+
+public:
+	/**
+	@param capacity Number of postings the queue can hold; must be a power of two
+	*/
+	explicit Posting_Queue(size_t capacity) : cells(new Cell[capacity]), mask(capacity - 1), tail(0)
+	{
+		if (capacity == 0 || (capacity & mask) != 0)
+			throw std::invalid_argument("queue capacity must be a power of two");
+		for (size_t i = 0; i < capacity; i++)
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	Posting_Queue(const Posting_Queue &) = delete;
+	Posting_Queue &operator=(const Posting_Queue &) = delete;
+
+	/**
+	Add a posting if there is room.  Safe to call from any number of threads.
+	@param posting The posting
+	@return true if it was queued, false if the queue is full
+	*/
+	bool try_push(const Posting &posting)
+	{
+		size_t pos = tail.load(std::memory_order_relaxed);
+		while (true) {
+			Cell &cell = cells[pos & mask];
+			size_t seq = cell.sequence.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+			if (diff == 0) {
+				// The cell is free for this lap; claim it
+				if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					cell.posting = posting;
+					cell.sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (diff < 0) {
+				return false;	// The consumer has not read this cell from the last lap yet
+			} else {
+				pos = tail.load(std::memory_order_relaxed);	// Another producer got there first
+			}
+		}
+	}
+
+	/**
+	Add a posting, yielding until there is room
+	@param posting The posting
+	*/
+	void push(const Posting &posting)
+	{
+		while (!try_push(posting))
+			std::this_thread::yield();
+	}
+
+	/**
+	Take up to max postings off the front of the queue.  Consumer only.
+	@param out	Where to put the postings
+	@param max	Room in out
+	@return how many postings were taken
+	*/
+	size_t pop(Posting *out, size_t max)
+	{
+		size_t n = 0;
+		while (n < max) {
+			Cell &cell = cells[head & mask];
+			if (cell.sequence.load(std::memory_order_acquire) != head + 1)
+				break;	// Empty, or the next producer is still filling its cell
+			out[n++] = cell.posting;
+			cell.sequence.store(head + mask + 1, std::memory_order_release);
+			head++;
+		}
+		return n;
+	}
+
+	/**
+	@return true if the consumer has nothing ready to read.  Consumer only.
+	*/
+	bool empty() const
+	{
+		return cells[head & mask].sequence.load(std::memory_order_acquire) != head + 1;
+	}
+};
+
+#endif
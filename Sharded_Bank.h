@@ -0,0 +1,354 @@
+#ifndef SHARDED_BANK_H_
+#define SHARDED_BANK_H_
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Bank.h"
+#include "Posting_Queue.h"
+
+/**
+A bank whose postings are served by a fixed set of shards.
+
+Account ids are sequential, so they are split into runs of Account_Store::BLOCK_ROWS
+consecutive ids (one store block each), and the runs are dealt out to the shards in turn; finding an account's
+shard is a shift and a modulo.  Each shard has its own queue and its own worker thread,
+and that thread is the only one that ever touches the shard's accounts.  Postings to a
+single account therefore never take a lock or contend with other shards, and each shard's
+balances sit in whole store blocks of their own.
+
+Producers push postings onto the shard's lock-free Posting_Queue and return at once.  The
+worker drains the queue a batch at a time, groups the batch by account and applies each
+account's postings together, so the account lookup, the balance load and store and the
+log append are paid once per account per batch rather than once per posting.
+
+A transfer between shards is carried out as two messages: the sender's shard checks the
+funds, debits and records the Transfer_Out leg, then sends a Transfer_Credit message to the
+receiver's shard, which credits and records the Transfer_In leg.  Until the credit is
+applied the money is in flight, so bank-wide totals are only exact after drain().  A
+bank-wide count of postings not yet applied covers the credits too: the debit's worker adds
+the credit to it before the debit itself is counted as applied, so the count cannot touch
+zero while a credit is still on its way.
+
+Accounts are opened through the underlying Bank, which should be concurrent if that happens
+from several threads.  While the shards are running, every posting must go through the
+Sharded_Bank, and bank-wide operations (interest runs, totals) should only be used after drain().
+*/
+class Sharded_Bank
+{
+private:
+	static const int ROUTE_SHIFT = 12;	// log2(Account_Store::BLOCK_ROWS)
+	static_assert((1u << ROUTE_SHIFT) == Account_Store::BLOCK_ROWS, "shards own whole store blocks");
+
+	static const size_t QUEUE_CAPACITY = 1 << 16;	// Postings each shard can have queued
+	static const size_t BATCH = 1024;				// Most postings a worker applies in one pass
+
+	/**
+	One shard: a queue of postings and the worker that applies them
+	*/
+	struct Shard
+	{
+		Posting_Queue queue;
+		std::atomic<size_t> pending;	// Postings sent to this shard and not applied yet
+		std::atomic<bool> sleeping;		// The worker found nothing pending and is waiting on wake
+		std::mutex lock;				// Only used to sleep and wake the worker
+		std::condition_variable wake;	// Signalled when postings arrive or the shard stops
+		bool stopping = false;			// Guarded by lock
+		std::thread worker;
+
+		Shard() : queue(QUEUE_CAPACITY), pending(0), sleeping(false) {}
+	};
+
+	Bank &bank;
+	std::vector<std::unique_ptr<Shard>> shards;
+	std::atomic<size_t> rejected;	// Postings that named an unknown account or lacked funds
+	std::atomic<size_t> in_flight;	// Postings sent to any shard, transfer credits included, and not applied yet
+	std::mutex drain_lock;			// Only used by drain() to wait for in_flight to reach zero
+	std::condition_variable drained;	// Signalled when in_flight drops to zero
+
+	/**
+	Wake a shard's worker if it has gone to sleep.  Called after pushing to its queue.
+	@param shard The shard
+	*/
+	void wake(Shard &shard)
+	{
+		// pending was raised before the push.  Either the worker sees that before it sleeps,
+		// or it set sleeping first and we see that here.  Only the first producer to see it
+		// asleep pays for the wakeup.
+		if (shard.sleeping.load() && shard.sleeping.exchange(false)) {
+			std::lock_guard<std::mutex> guard(shard.lock);
+			shard.wake.notify_one();
+		}
+	}
+
+	/**
+	Queue a posting for the shard that owns its account, waiting if that queue is full
+	@param posting The posting
+	*/
+	void send(const Posting &posting)
+	{
+		Shard &shard = *shards[shard_of(posting.account)];
+		in_flight++;
+		shard.pending++;
+		shard.queue.push(posting);
+		wake(shard);
+	}
+
+	/**
+	Pass on the transfer credits a worker has produced.  Workers never wait on a full queue
+	(two shards could end up waiting on each other), so whatever does not fit stays in the outbox.
+	@param outbox Credits waiting to be sent; already counted in in_flight and the receiving shard's pending
+	*/
+	void flush(std::vector<Posting> &outbox)
+	{
+		size_t kept = 0;
+		for (const Posting &posting : outbox) {
+			Shard &shard = *shards[shard_of(posting.account)];
+			if (shard.queue.try_push(posting))
+				wake(shard);
+			else
+				outbox[kept++] = posting;
+		}
+		outbox.resize(kept);
+	}
+
+	/**
+	Apply a batch of postings.  Runs on the worker of the shard that owns them.
+
+	The batch is sorted by account, keeping each account's postings in the order they
+	arrived.  Each account is then looked up once, its balance is carried in a local while
+	its postings are applied, and its records are appended to the log in one go.
+	@param batch	The postings
+	@param n		How many postings
+	@param order	Scratch space for the sort
+	@param records	Scratch space for one account's records
+	@param outbox	Where to put the credits of transfers debited here
+	*/
+	void apply(const Posting *batch, size_t n, std::vector<uint64_t> &order,
+			std::vector<Transaction> &records, std::vector<Posting> &outbox)
+	{
+		// Sort key: account id in the high half, arrival position in the low half
+		order.clear();
+		for (size_t i = 0; i < n; i++)
+			order.push_back((uint64_t)(uint32_t)batch[i].account << 32 | i);
+		std::sort(order.begin(), order.end());
+
+		int64_t now = Transaction::posting_time();	// Deposits and withdrawals in one batch share a timestamp
+		size_t run = 0;
+		while (run < n) {
+			int acct_number = batch[order[run] & 0xffffffff].account;
+			size_t end = run + 1;
+			while (end < n && batch[order[end] & 0xffffffff].account == acct_number)
+				end++;
+
+			Account *acct = bank.get_account(acct_number);
+			if (acct == NULL) {
+				rejected += end - run;
+				run = end;
+				continue;
+			}
+			int cust = acct->customer_number;
+			Money check_charge = acct->schedule->check_charge;
+			Money overdraft = acct->schedule->overdraft_penalty;
+			Money balance = *acct->balance;
+			records.clear();
+
+			for (; run < end; run++) {
+				const Posting &posting = batch[order[run] & 0xffffffff];
+				switch (posting.kind) {
+				case Posting::Kind::Deposit:
+					balance += posting.amount;
+					records.emplace_back(cust, Transaction_Type::Deposit, posting.amount, check_charge, overdraft, 0, now);
+					break;
+				case Posting::Kind::Withdrawal:
+					balance -= posting.amount;
+					records.emplace_back(cust, Transaction_Type::Withdrawal, posting.amount, check_charge, overdraft, 0, now);
+					acct->charge_withdrawal_fees(balance, [&](Transaction_Type fee_type, Money fee) {
+						records.emplace_back(cust, fee_type, fee, check_charge, overdraft, 0, now);
+					});
+					break;
+				case Posting::Kind::Transfer_Debit:
+					if (bank.get_account(posting.counterparty) == NULL || posting.counterparty == acct_number
+							|| posting.amount <= Money() || balance < posting.amount) {
+						rejected++;
+						break;
+					}
+					balance -= posting.amount;
+					records.emplace_back(cust, Transaction_Type::Transfer_Out, posting.amount, check_charge, overdraft,
+							posting.counterparty, posting.when);
+					// Hand the second half to the receiver's shard (possibly this one).  It is
+					// counted before this batch is, so in_flight never drops to zero in between.
+					in_flight++;
+					shards[shard_of(posting.counterparty)]->pending++;
+					outbox.push_back(Posting{Posting::Kind::Transfer_Credit, posting.counterparty, acct_number,
+							posting.amount, posting.when});
+					break;
+				case Posting::Kind::Transfer_Credit:
+					balance += posting.amount;
+					records.emplace_back(cust, Transaction_Type::Transfer_In, posting.amount, check_charge, overdraft,
+							posting.counterparty, posting.when);
+					break;
+				}
+			}
+			*acct->balance = balance;
+			acct->transactions.append(records.data(), records.size());
+			if (acct->journal)
+				acct->journal->append(acct_number, records.data(), records.size());
+		}
+	}
+
+	/**
+	Worker loop: take postings off the queue a batch at a time and apply them, sleeping when there are none
+	@param shard The shard this worker serves
+	*/
+	void run(Shard &shard)
+	{
+		std::unique_ptr<Posting[]> batch(new Posting[BATCH]);
+		std::vector<uint64_t> order;
+		std::vector<Transaction> records;
+		std::vector<Posting> outbox;
+		order.reserve(BATCH);
+		while (true) {
+			if (!outbox.empty())
+				flush(outbox);
+			size_t n = shard.queue.pop(batch.get(), BATCH);
+			if (n > 0) {
+				apply(batch.get(), n, order, records, outbox);
+				shard.pending -= n;
+				if ((in_flight -= n) == 0) {
+					std::lock_guard<std::mutex> guard(drain_lock);
+					drained.notify_all();
+				}
+				continue;
+			}
+			if (!outbox.empty() || shard.pending != 0) {
+				// Some other shard's queue is full, or a posting for us is still being pushed
+				std::this_thread::yield();
+				continue;
+			}
+
+			// sleeping is raised again before every look at pending, not just the first: a
+			// producer that saw it raised for an earlier sleep can clear it late and wake us
+			// with nothing to do, and if we then went back to waiting with it lowered, no
+			// later producer would wake us.
+			std::unique_lock<std::mutex> guard(shard.lock);
+			while (true) {
+				shard.sleeping = true;
+				if (shard.stopping || shard.pending != 0)
+					break;
+				shard.wake.wait(guard);
+			}
+			shard.sleeping = false;
+			if (shard.stopping && shard.pending == 0)
+				return;
+		}
+	}
+
+public:
+	/**
+	Start the shard workers
+	@param bank_		The bank whose accounts are served
+	@param shard_count	Number of shards (and worker threads), or 0 for one per hardware thread
+	*/
+	Sharded_Bank(Bank &bank_, unsigned shard_count = 0) : bank(bank_), rejected(0), in_flight(0)
+	{
+		if (shard_count == 0)
+			shard_count = std::max(1u, std::thread::hardware_concurrency());
+		for (unsigned i = 0; i < shard_count; i++)
+			shards.emplace_back(new Shard);
+		for (std::unique_ptr<Shard> &shard : shards) {
+			Shard *s = shard.get();
+			s->worker = std::thread([this, s]() { run(*s); });
+		}
+	}
+
+	/**
+	Apply everything still queued, then stop the workers
+	*/
+	~Sharded_Bank()
+	{
+		drain();
+		for (std::unique_ptr<Shard> &shard : shards) {
+			{
+				std::lock_guard<std::mutex> guard(shard->lock);
+				shard->stopping = true;
+			}
+			shard->wake.notify_one();
+			shard->worker.join();
+		}
+	}
+
+	Sharded_Bank(const Sharded_Bank &) = delete;
+	Sharded_Bank &operator=(const Sharded_Bank &) = delete;
+
+	/**
+	Find the shard that owns an account
+	@param acct_number The account id
+	@return the shard number
+	*/
+	unsigned shard_of(int acct_number) const
+	{
+		return (unsigned)((Bank::row_of(acct_number) >> ROUTE_SHIFT) % shards.size());
+	}
+
+	unsigned shard_count() const { return (unsigned)shards.size(); }
+	Bank &get_bank() { return bank; }
+
+	/**
+	Queue a deposit
+	@param acct_number	The account id
+	@param amt			The amount to deposit
+	*/
+	void make_deposit(int acct_number, Money amt)
+	{
+		send(Posting{Posting::Kind::Deposit, acct_number, 0, amt, 0});
+	}
+
+	/**
+	Queue a withdrawal
+	@param acct_number	The account id
+	@param amt			The amount to withdraw
+	*/
+	void make_withdrawal(int acct_number, Money amt)
+	{
+		send(Posting{Posting::Kind::Withdrawal, acct_number, 0, amt, 0});
+	}
+
+	/**
+	Queue a transfer.  It is rejected when applied if either account does not exist,
+	both are the same, the amount is not positive, or the sender has too little money.
+	@param from	The account id the money leaves
+	@param to	The account id the money goes to
+	@param amt	The amount to transfer
+	*/
+	void transfer(int from, int to, Money amt)
+	{
+		send(Posting{Posting::Kind::Transfer_Debit, from, to, amt, Transaction::posting_time()});
+	}
+
+	/**
+	Wait until every queued posting, including the second halves of transfers, is applied
+	*/
+	void drain()
+	{
+		// Checking each shard's pending in turn is not enough: a shard already passed can be
+		// handed a transfer credit by one not yet looked at.  in_flight counts every shard's
+		// postings and the credits between them, and only reaches zero when all are applied.
+		std::unique_lock<std::mutex> guard(drain_lock);
+		drained.wait(guard, [this]() { return in_flight == 0; });
+	}
+
+	/**
+	@return how many postings were rejected so far
+	*/
+	size_t rejected_postings() const
+	{
+		return rejected;
+	}
+};
+
+#endif
@@ -0,0 +1,307 @@
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Bank.h"
+#include "Journal.h"
+
+/**
+Saves the state of a Bank to a single binary file and loads it back.
+
+The file is laid out so it can be memory-mapped and walked in place:
+
+	header		magic, version, the id counters, the journal position and the section sizes
+	customers	one fixed-size Customer_Row per customer, in id order
+	accounts	one fixed-size Account_Row per account, in id order
+	strings		every name, address and telephone number back to back, referred to by offset
+
+Loading maps the file, sizes the bank's containers once, and rebuilds customers and accounts
+straight from the rows, with no parsing.  The snapshot remembers how far the bank's journal
+had got when it was taken, so the postings made since then can be replayed from the journal
+on top of it.  Transaction history from before the snapshot is not reloaded; it stays in the journal.
+
+The journal only holds postings, so it cannot bring back an account opened after the snapshot.
+Replaying around such an account would lose its balance, and the next account opened would
+get its id and then its postings, so load() refuses a journal that names one and leaves the
+bank untouched.  save() after opening accounts keeps the journal replayable.
+*/
+class Snapshot
+{
+public:
+	/**
+	What load() did
+	*/
+	struct Load_Result
+	{
+		size_t customers;			// Customers loaded
+		size_t accounts;			// Accounts loaded
+		uint64_t journal_sequence;	// The journal position the snapshot was taken at
+		uint64_t replayed;			// Journal records applied on top of the snapshot
+	};
+
+private:
+	static constexpr char MAGIC[8] = {'B', 'A', 'N', 'K', 'S', 'N', 'A', 'P'};
+	static const uint32_t VERSION = 1;
+
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		int32_t account_id;			// Last account id handed out
+		int32_t customer_id;		// Last customer id handed out
+		uint32_t reserved;
+		uint64_t journal_sequence;	// Journal records up to here are included in the balances
+		uint64_t customer_count;
+		uint64_t account_count;
+		uint64_t string_bytes;
+	};
+
+	struct String_Ref
+	{
+		uint32_t offset;
+		uint32_t length;
+	};
+
+	struct Customer_Row
+	{
+		int32_t id;
+		int32_t age;
+		Customer_Tier tier;
+		uint8_t reserved[7];
+		String_Ref name;
+		String_Ref address;
+		String_Ref telephone;
+	};
+
+	struct Account_Row
+	{
+		int32_t number;
+		uint32_t customer;		// Index of the owner in the customer rows
+		int64_t balance;		// In cents
+		Account_Type type;
+		uint8_t reserved[7];
+	};
+
+	static_assert(sizeof(Header) == 56 && sizeof(Customer_Row) == 40 && sizeof(Account_Row) == 24,
+			"snapshot rows have a fixed layout");
+
+	[[noreturn]] static void fail(const std::string &what)
+	{
+		throw std::runtime_error(what + ": " + std::strerror(errno));
+	}
+
+	/**
+	Add a string to the string section
+	@param strings	The string section so far
+	@param text		The string
+	@return where it was put
+	*/
+	static String_Ref add_string(std::string &strings, std::string_view text)
+	{
+		String_Ref ref{(uint32_t)strings.size(), (uint32_t)text.size()};
+		strings.append(text.data(), text.size());
+		return ref;
+	}
+
+public:
+	/**
+	Write a snapshot of a bank.  In a concurrent bank, the directory's read lock and every
+	account stripe lock are held from the first row read until the file has been renamed into
+	place: no account can be opened and no posting applied in between.
+	The file is written next to path and renamed over it, so a crash never leaves half a snapshot.
+	@param bank The bank
+	@param path Where to write the snapshot
+	*/
+	static void save(const Bank &bank, const std::string &path)
+	{
+		auto directory = bank.read_directory();
+		auto locks = bank.lock_all_accounts();
+
+		// The balances include every posting the journal holds so far, so those must be durable
+		// before the snapshot says so: otherwise a crash could hand their sequence numbers out
+		// again, and load() would skip the new postings as already included
+		uint64_t journaled = 0;
+		if (bank.journal) {
+			bank.journal->commit();
+			journaled = bank.journal->size();
+		}
+
+		std::vector<Customer_Row> customers;
+		std::vector<Account_Row> accounts;
+		std::string strings;
+		customers.reserve(bank.customers.size());
+		accounts.reserve(bank.store.size());
+
+		std::unordered_map<const Customer *, uint32_t> index;
+		index.reserve(bank.customers.size());
+		for (Customer *cust : bank.customers) {
+			Customer_Row row = {};
+			row.id = cust->get_customer_id();
+			row.age = cust->get_age();
+			row.tier = cust->get_tier();
+			row.name = add_string(strings, cust->get_name());
+			row.address = add_string(strings, cust->get_address());
+			row.telephone = add_string(strings, cust->get_telephone_number());
+			index.emplace(cust, (uint32_t)customers.size());
+			customers.push_back(row);
+		}
+		for (size_t b = 0; b < bank.store.block_count(); b++) {
+			const Account_Store::Block &block = bank.store.block(b);
+			for (size_t i = 0; i < bank.store.block_size(b); i++) {
+				Account_Row row = {};
+				row.number = block.account_number[i];
+				row.customer = index.at(block.account[i]->get_customer());
+				row.balance = block.balance[i].get_cents();
+				row.type = block.type[i];
+				accounts.push_back(row);
+			}
+		}
+
+		Header header = {};
+		std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = VERSION;
+		header.account_id = bank.account_id;
+		header.customer_id = bank.customer_id;
+		header.journal_sequence = journaled;
+		header.customer_count = customers.size();
+		header.account_count = accounts.size();
+		header.string_bytes = strings.size();
+
+		std::string temp = path + ".tmp";
+		FILE *out = std::fopen(temp.c_str(), "wb");
+		if (out == NULL)
+			fail("cannot create snapshot " + temp);
+		bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1
+				&& std::fwrite(customers.data(), sizeof(Customer_Row), customers.size(), out) == customers.size()
+				&& std::fwrite(accounts.data(), sizeof(Account_Row), accounts.size(), out) == accounts.size()
+				&& std::fwrite(strings.data(), 1, strings.size(), out) == strings.size()
+				&& std::fflush(out) == 0 && fsync(fileno(out)) == 0;
+		if (std::fclose(out) != 0 || !ok || std::rename(temp.c_str(), path.c_str()) != 0) {
+			int saved = errno;
+			std::remove(temp.c_str());
+			errno = saved;
+			fail("cannot write snapshot " + path);
+		}
+	}
+
+	/**
+	Load a snapshot into an empty bank, then replay the postings the journal holds beyond it.
+	The bank's own journal, if any, is not written to while replaying.
+	@param bank			The bank; must not have any customers yet
+	@param path			The snapshot file
+	@param journal_path	Base path of the journal to replay, or empty to skip replay
+	@return what was loaded and replayed
+	@throws std::runtime_error if the snapshot is not one, is corrupt, or the journal has postings to
+			accounts opened after it was taken; the bank is left empty in the last case
+	*/
+	static Load_Result load(Bank &bank, const std::string &path, const std::string &journal_path = "")
+	{
+		auto directory = bank.write_directory();
+		auto locks = bank.lock_all_accounts();
+		if (!bank.customers.empty())
+			throw std::logic_error("snapshots can only be loaded into an empty bank");
+
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			fail("cannot open snapshot " + path);
+		struct stat st;
+		if (fstat(fd, &st) != 0) {
+			::close(fd);
+			fail("cannot stat snapshot " + path);
+		}
+		size_t size = (size_t)st.st_size;
+		void *map = size >= sizeof(Header) ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+		::close(fd);
+		if (map == MAP_FAILED)
+			throw std::runtime_error("not a snapshot: " + path);
+		madvise(map, size, MADV_SEQUENTIAL);
+
+		// Unmap however we leave
+		struct Unmap
+		{
+			void *map;
+			size_t size;
+			~Unmap() { munmap(map, size); }
+		} unmap{map, size};
+
+		const char *base = static_cast<const char *>(map);
+		const Header &header = *reinterpret_cast<const Header *>(base);
+		if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION
+				|| size != sizeof(Header) + header.customer_count * sizeof(Customer_Row)
+					+ header.account_count * sizeof(Account_Row) + header.string_bytes)
+			throw std::runtime_error("not a snapshot: " + path);
+		// Account ids are dense, so the last one handed out follows from the row count
+		if ((int64_t)header.account_id != Bank::FIRST_ACCOUNT_ID + (int64_t)header.account_count)
+			throw std::runtime_error("corrupt snapshot: " + path);
+
+		// Every account the journal names past the snapshot must be one the snapshot has
+		uint64_t unknown = 0;
+		if (!journal_path.empty())
+			Journal::read(journal_path, header.journal_sequence, [&](const Journal_Record &record) {
+				if (record.account <= Bank::FIRST_ACCOUNT_ID || record.account > header.account_id)
+					unknown++;
+			});
+		if (unknown > 0)
+			throw std::runtime_error("journal " + journal_path + " has postings to accounts opened after snapshot "
+					+ path + " was taken (" + std::to_string(unknown) + " of them)");
+		const Customer_Row *cust_rows = reinterpret_cast<const Customer_Row *>(base + sizeof(Header));
+		const Account_Row *acct_rows = reinterpret_cast<const Account_Row *>(cust_rows + header.customer_count);
+		const char *strings = reinterpret_cast<const char *>(acct_rows + header.account_count);
+		auto text = [&](String_Ref ref) {
+			if ((uint64_t)ref.offset + ref.length > header.string_bytes)
+				throw std::runtime_error("corrupt snapshot: " + path);
+			return std::string_view(strings + ref.offset, ref.length);
+		};
+
+		// Size everything once, then rebuild through the bank's own factories, which hand
+		// out ids in order; the rows are in id order, so each must get back its old id
+		bank.customers.reserve(header.customer_count);
+		bank.customers_by_name.reserve(header.customer_count);
+		bank.accounts_by_customer.reserve(header.customer_count);
+		bank.store.reserve(header.account_count);
+		std::vector<Customer *> loaded;
+		loaded.reserve(header.customer_count);
+		for (uint64_t i = 0; i < header.customer_count; i++) {
+			const Customer_Row &row = cust_rows[i];
+			if (row.id <= bank.customer_id)
+				throw std::runtime_error("corrupt snapshot: " + path);
+			bank.customer_id = row.id - 1;
+			Customer *cust = bank.add_customer(text(row.name), text(row.address), text(row.telephone),
+					row.age, customer_tier_name(row.tier));
+			if (cust == NULL)
+				throw std::runtime_error("corrupt snapshot: " + path);
+			loaded.push_back(cust);
+		}
+		for (uint64_t i = 0; i < header.account_count; i++) {
+			const Account_Row &row = acct_rows[i];
+			if (row.customer >= loaded.size() || row.number != bank.account_id + 1)
+				throw std::runtime_error("corrupt snapshot: " + path);
+			Account *acct = bank.add_account(loaded[row.customer],
+					row.type == Account_Type::Savings ? "savings" : "checking");
+			acct->set_balance(Money::from_cents(row.balance));
+		}
+		// The counters now stand at the last row loaded; the header must agree before new ids follow on
+		if (header.account_id != bank.account_id || header.customer_id != bank.customer_id)
+			throw std::runtime_error("corrupt snapshot: " + path);
+
+		Load_Result result = {loaded.size(), (size_t)header.account_count, header.journal_sequence, 0};
+		if (!journal_path.empty())
+			Journal::read(journal_path, header.journal_sequence, [&](const Journal_Record &record) {
+				bank.replay_posting(record.account, record.tran);
+				result.replayed++;
+			});
+		return result;
+	}
+};
+
+#endif
@@ -1,33 +1,323 @@
-#ifndef TRANSACTION_H_
-#define TRANSACTION_H_
-#include <string>
-#include <sstream>
-
-/**
-Keeps a record for each transaction performed
-*/
-class Transaction 
-{
-private:
-	std::string customer_number;
-	std::string transaction_type;
-	double amount;
-	std::string fees;
-public:
-
-	Transaction(int customer_number, std::string type, double amt, std::string fees)
-	{
-		this->customer_number = customer_number;
-		this->transaction_type = type;
-		this->amount = amt;
-		this->fees = fees;
-	}
-
-	std::string process_tran()
-	{
-		std::stringstream ss;
-		ss << "Transaction: " << transaction_type << " Amount: " << amount << " " << fees;
-		return ss.str();
-	}
-};
+#ifndef TRANSACTION_H_
+#define TRANSACTION_H_
+#include <time.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include "Money.h"
+#include <sstream>
+
+/**
+The kinds of transactions an account can record
+*/
+enum class Transaction_Type : uint8_t
+{
+	Deposit,
+	Withdrawal,
+	Interest,
+	Transfer_Out,	// Money sent to another account; the counterparty is the receiving account
+	Transfer_In,	// Money received from another account; the counterparty is the sending account
+	Check_Charge,	// The customer's check charge, taken for a withdrawal from a checking account
+	Overdraft_Penalty	// The customer's overdraft penalty, taken for a withdrawal that leaves the balance negative
+};
+
+/**
+Keeps a record for each transaction performed.
+
+The record is a fixed 32-byte plain value: amounts are stored as Money (whole cents) and the type is an
+enum, so recording a posting copies a few integers instead of building strings.  The text
+description is only produced when someone asks for it through process_tran().
+*/
+class Transaction 
+{
+private:
+	int64_t timestamp;			// When the transaction happened, in nanoseconds since the epoch
+	Money amount;				// Amount of the transaction
+	int32_t customer_number;	// The customer who owns the account
+	int32_t counterparty;		// For transfers, the account on the other side; 0 otherwise
+	uint16_t check_charge;		// Customer's check charge at the time, in cents
+	uint16_t overdraft_fee;		// Customer's overdraft fee at the time, in cents
+	Transaction_Type transaction_type;
+
+public:
+	// Fees are kept in 16 bits to hold the record at 32 bytes; Account.h checks every tier's fees fit
+	static constexpr int64_t MAX_FEE_CENTS = UINT16_MAX;
+
+
+	/**
+	@return the current time, in the form stored in records
+	*/
+	static int64_t now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+	/**
+	@return the current time for stamping postings, from the coarse real-time clock where there
+	is one (Linux).  It is good to a few milliseconds and costs a fraction of now(), which
+	matters when every deposit and withdrawal reads it.  Elsewhere (e.g. macOS) it is now().
+	*/
+	static int64_t posting_time()
+	{
+#ifdef CLOCK_REALTIME_COARSE
+		timespec ts;
+		clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+		return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+		return now();
+#endif
+	}
+
+	/**
+	@param customer_number	The customer who owns the account
+	@param type				The kind of transaction
+	@param amt				The amount
+	@param check_charge		The customer's check charge
+	@param overdraft_fee	The customer's overdraft fee
+	@param counterparty		For transfers, the account on the other side
+	@param when				Time of the transaction; both legs of a transfer share one
+	*/
+	Transaction(int customer_number, Transaction_Type type, Money amt, Money check_charge, Money overdraft_fee,
+			int counterparty = 0, int64_t when = now())
+		: timestamp(when),
+		  amount(amt),
+		  customer_number(customer_number),
+		  counterparty(counterparty),
+		  check_charge((uint16_t)check_charge.get_cents()),
+		  overdraft_fee((uint16_t)overdraft_fee.get_cents()),
+		  transaction_type(type)
+	{
+	}
+
+	int get_customer_number() const { return customer_number; }
+	int get_counterparty() const { return counterparty; }
+	Transaction_Type get_type() const { return transaction_type; }
+	Money get_amount() const { return amount; }
+	Money get_check_charge() const { return Money::from_cents(check_charge); }
+	Money get_overdraft_fee() const { return Money::from_cents(overdraft_fee); }
+	int64_t get_timestamp() const { return timestamp; }
+
+	/**
+	Name of a transaction type, as shown in reports
+	*/
+	static const char *type_name(Transaction_Type type)
+	{
+		switch (type) {
+		case Transaction_Type::Deposit:
+			return "Deposit";
+		case Transaction_Type::Withdrawal:
+			return "Withdrawal";
+		case Transaction_Type::Interest:
+			return "Add interest";
+		case Transaction_Type::Transfer_Out:
+			return "Transfer to";
+		case Transaction_Type::Transfer_In:
+			return "Transfer from";
+		case Transaction_Type::Check_Charge:
+			return "Check charge";
+		case Transaction_Type::Overdraft_Penalty:
+			return "Overdraft fee";
+		}
+		return "Unknown";
+	}
+
+	std::string process_tran() const
+	{
+		std::stringstream ss;
+		ss << "Transaction: " << type_name(transaction_type);
+		if (counterparty)
+			ss << " " << counterparty;
+		ss << " Amount: " << get_amount()
+			<< " Check Charge: " << get_check_charge() << " Overdraft Fee: " << get_overdraft_fee();
+		return ss.str();
+	}
+};
+
+static_assert(sizeof(Transaction) == 32, "Transaction records are meant to stay 32 bytes");
+
+/**
+The transaction history of one account.
+
+Records are held in a chain of slabs.  Each slab is one allocation and is twice the size of
+the one before it (up to MAX_SLAB records), so an account with a handful of postings stays
+small while a busy account allocates once per thousand postings.  Records never move once
+appended, and they are all freed together when the log goes away.
+
+A slot holds only what changes from one posting to the next: the time, amount, counterparty
+and type, in 24 bytes.  The owner and the fees in force, which only change when an account
+changes hands or tiers, are kept once in the slab header, and a record posted under different
+ones starts a new slab.  Iterating puts each Transaction back together from the two.
+
+The next free slot, the end of the newest slab and the owner and fees it was started under
+are kept in the log itself, so appending a record only writes the slot: the slab header is
+not read or written until the slab fills.
+*/
+class Transaction_Log
+{
+private:
+	static const size_t FIRST_SLAB = 4;
+	static const size_t MAX_SLAB = 1024;
+
+	// One slot: what a record does not share with the rest of its slab
+	struct Entry
+	{
+		int64_t timestamp;
+		Money amount;
+		int32_t counterparty;
+		Transaction_Type type;
+	};
+	static_assert(sizeof(Entry) == 24, "log slots are meant to stay 24 bytes");
+
+	// Slab header; the slots follow it in the same allocation
+	struct alignas(Entry) Slab
+	{
+		Slab *next;
+		uint32_t capacity;
+		uint32_t used;		// Slots in use; for the newest slab it is only brought up to date when the slab is left
+		uint64_t context;	// Owner and fees of every record in the slab, see context_of
+
+		Entry *records() { return reinterpret_cast<Entry *>(this + 1); }
+	};
+
+	Slab *head = NULL;	// Oldest slab, where iteration starts
+	Slab *tail = NULL;	// Newest slab, where records are appended
+	Entry *cursor = NULL;	// The next free slot in tail
+	Entry *limit = NULL;	// One past the last slot in tail
+	uint64_t context = 0;	// tail's context
+	size_t count = 0;
+
+	/**
+	@return the owner and fees of a record, packed so two can be compared in one go
+	*/
+	static uint64_t context_of(const Transaction &tran)
+	{
+		return (uint64_t)(uint32_t)tran.get_customer_number() << 32
+				| (uint64_t)tran.get_check_charge().get_cents() << 16 | (uint64_t)tran.get_overdraft_fee().get_cents();
+	}
+
+	/**
+	Start a new slab for records with the given owner and fees
+	@param key Their context_of
+	*/
+	void grow(uint64_t key)
+	{
+		context = key;
+		if (tail && cursor == tail->records()) {
+			// Nothing was appended under the newest slab's context, so it can take this one
+			tail->context = key;
+			return;
+		}
+		size_t capacity = tail ? tail->capacity * 2 : FIRST_SLAB;
+		if (capacity > MAX_SLAB)
+			capacity = MAX_SLAB;
+		Slab *slab = static_cast<Slab *>(::operator new(sizeof(Slab) + capacity * sizeof(Entry)));
+		slab->next = NULL;
+		slab->capacity = (uint32_t)capacity;
+		slab->used = 0;
+		slab->context = key;
+		if (tail) {
+			tail->used = (uint32_t)(cursor - tail->records());
+			tail->next = slab;
+		} else {
+			head = slab;
+		}
+		tail = slab;
+		cursor = slab->records();
+		limit = cursor + capacity;
+	}
+
+public:
+	/**
+	Walks the records in the order they were appended.  Records are put back together as
+	they are visited, so the iterator yields them by value.
+	*/
+	class const_iterator
+	{
+	private:
+		const Slab *slab;
+		size_t index;
+	public:
+		typedef std::input_iterator_tag iterator_category;
+		typedef Transaction value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const Transaction *pointer;
+		typedef Transaction reference;
+
+		const_iterator(const Slab *slab, size_t index) : slab(slab), index(index) {}
+		Transaction operator*() const
+		{
+			const Entry &entry = const_cast<Slab *>(slab)->records()[index];
+			return Transaction((int32_t)(slab->context >> 32), entry.type, entry.amount,
+					Money::from_cents((slab->context >> 16) & 0xffff), Money::from_cents(slab->context & 0xffff),
+					entry.counterparty, entry.timestamp);
+		}
+		const_iterator &operator++()
+		{
+			if (++index == slab->used && slab->next) {
+				slab = slab->next;
+				index = 0;
+			}
+			return *this;
+		}
+		bool operator==(const const_iterator &other) const { return slab == other.slab && index == other.index; }
+		bool operator!=(const const_iterator &other) const { return !(*this == other); }
+	};
+
+	Transaction_Log() {}
+	Transaction_Log(const Transaction_Log &) = delete;
+	Transaction_Log &operator=(const Transaction_Log &) = delete;
+
+	~Transaction_Log()
+	{
+		clear();
+	}
+
+	/**
+	Append a record to the end of the log
+	@param tran The record to store
+	*/
+	void append(const Transaction &tran)
+	{
+		uint64_t key = context_of(tran);
+		if (cursor == limit || key != context)
+			grow(key);
+		*cursor++ = Entry{tran.get_timestamp(), tran.get_amount(), tran.get_counterparty(), tran.get_type()};
+		count++;
+	}
+
+	/**
+	Append a run of records in one go
+	@param first	The first record to store
+	@param n		How many records to store
+	*/
+	void append(const Transaction *first, size_t n)
+	{
+		for (size_t i = 0; i < n; i++)
+			append(first[i]);
+	}
+
+	/**
+	Release every slab
+	*/
+	void clear()
+	{
+		while (head) {
+			Slab *next = head->next;
+			::operator delete(head);
+			head = next;
+		}
+		tail = NULL;
+		cursor = limit = NULL;
+		context = 0;
+		count = 0;
+	}
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	const_iterator begin() const { return const_iterator(head, 0); }
+	const_iterator end() const { return const_iterator(tail, tail ? cursor - tail->records() : 0); }
+};
 #endif
\ No newline at end of file
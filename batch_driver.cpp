@@ -0,0 +1,171 @@
+#include <charconv>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include "Bank.h"
+#include "batch_driver.h"
+
+namespace {
+
+const size_t MAX_FIELDS = 7;	// The long form of open
+
+/**
+	Split a line into its '|'-separated fields, in place
+
+	@param line		The line
+	@param fields	Where to put the fields
+	@return			The number of fields, or MAX_FIELDS + 1 if there are too many
+*/
+size_t split(std::string_view line, std::string_view *fields)
+{
+	size_t count = 0;
+	while (true) {
+		if (count == MAX_FIELDS)
+			return MAX_FIELDS + 1;
+		size_t bar = line.find('|');
+		fields[count++] = line.substr(0, bar);
+		if (bar == std::string_view::npos)
+			return count;
+		line.remove_prefix(bar + 1);
+	}
+}
+
+/**
+	Read a whole field as a number
+
+	@param field	The field
+	@param value	Set to the number
+	@return			true if the field was a number and nothing else
+*/
+bool parse_int(std::string_view field, int &value)
+{
+	std::from_chars_result result = std::from_chars(field.data(), field.data() + field.size(), value);
+	return result.ec == std::errc() && result.ptr == field.data() + field.size();
+}
+
+/**
+	Read a dollar amount exactly, e.g. 12, 12.5 or 12.50
+
+	@param field	The field
+	@param amt		Set to the amount
+	@return			true if the field was an amount with at most two decimals, small enough
+					to hold in cents
+*/
+bool parse_money(std::string_view field, Money &amt)
+{
+	bool negative = !field.empty() && field[0] == '-';
+	if (negative)
+		field.remove_prefix(1);
+	size_t dot = field.find('.');
+	std::string_view whole = field.substr(0, dot);
+	std::string_view frac = dot == std::string_view::npos ? std::string_view() : field.substr(dot + 1);
+	if (whole.empty() || frac.size() > 2 || (dot != std::string_view::npos && frac.empty()))
+		return false;
+
+	long long dollars = 0;
+	std::from_chars_result result = std::from_chars(whole.data(), whole.data() + whole.size(), dollars);
+	if (result.ec != std::errc() || result.ptr != whole.data() + whole.size() || dollars < 0)
+		return false;
+	long long cents = 0;
+	for (size_t i = 0; i < 2; i++) {
+		char c = i < frac.size() ? frac[i] : '0';
+		if (c < '0' || c > '9')
+			return false;
+		cents = cents * 10 + (c - '0');
+	}
+	if (dollars > (INT64_MAX - cents) / 100)
+		return false;	// Too many cents to count
+	cents += dollars * 100;
+	amt = Money::from_cents(negative ? -cents : cents);
+	return true;
+}
+
+bool valid_account_type(std::string_view type)
+{
+	return type == "savings" || type == "checking";
+}
+
+bool valid_customer_type(std::string_view type)
+{
+	return type == "adult" || type == "senior" || type == "student";
+}
+
+}
+
+size_t run_batch(std::istream &in, std::ostream &out, Bank &bank)
+{
+	std::string line;		// Reused for every line, so reading does not allocate once it has grown
+	std::string statement;	// Likewise for rendering account listings
+	std::string_view fields[MAX_FIELDS];
+	size_t line_number = 0;
+	size_t commands = 0;
+
+	while (std::getline(in, line)) {
+		line_number++;
+		std::string_view text = line;
+		if (!text.empty() && text.back() == '\r')
+			text.remove_suffix(1);
+		if (text.empty() || text[0] == '#')
+			continue;
+
+		size_t count = split(text, fields);
+		std::string_view command = fields[0];
+		int acct_id;
+		Money amt;
+
+		if (command == "open" && (count == 3 || count == 7)) {
+			if (!valid_account_type(fields[2])) {
+				out << "Line " << line_number << ": unknown account type " << fields[2] << '\n';
+				continue;
+			}
+			Account *acct = bank.add_account(fields[1], std::string(fields[2]));
+			if (acct == NULL && count == 7) {
+				int age;
+				if (!parse_int(fields[5], age) || !valid_customer_type(fields[6])) {
+					out << "Line " << line_number << ": bad age or customer type\n";
+					continue;
+				}
+				acct = bank.add_account(std::string(fields[1]), std::string(fields[3]), std::string(fields[4]),
+						age, std::string(fields[6]), std::string(fields[2]));
+			}
+			if (acct)
+				out << "Your new account ID is " << acct->get_account() << '\n';
+			else
+				out << "Sorry.  We failed to create an account for " << fields[1] << '\n';
+		} else if ((command == "deposit" || command == "withdraw") && count == 3) {
+			if (!parse_int(fields[1], acct_id) || !parse_money(fields[2], amt)) {
+				out << "Line " << line_number << ": bad account id or amount\n";
+				continue;
+			}
+			// Checked here so the message goes to out, rather than the Bank's own message to cout
+			if (bank.get_account(acct_id) == NULL) {
+				out << "Sorry, account " << acct_id << " could not be found.\n";
+			} else if (command == "deposit") {
+				bank.make_deposit(acct_id, amt);
+			} else {
+				bank.make_withdrawal(acct_id, amt);
+			}
+		} else if (command == "list" && count == 2) {
+			statement.clear();
+			bank.render_statement(fields[1], statement);
+			out << statement;
+		} else if (command == "interest" && count == 1) {
+			bank.accrue_interest();
+		} else if (command == "stats" && count == 1) {
+			bank.dump_instrumentation(out);
+		} else if (command == "stats" && count == 2) {
+			std::ofstream file{std::string(fields[1])};
+			bank.dump_instrumentation(file);
+			if (!file) {
+				out << "Line " << line_number << ": cannot write " << fields[1] << '\n';
+				continue;
+			}
+		} else {
+			out << "Line " << line_number << ": unknown command\n";
+			continue;
+		}
+		commands++;
+	}
+	return commands;
+}
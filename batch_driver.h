@@ -0,0 +1,38 @@
+#ifndef BATCH_DRIVER_H_
+#define BATCH_DRIVER_H_
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+
+class Bank;
+
+/**
+	Run a stream of banking commands against a bank, without prompts.
+
+	One command per line, fields separated by '|'.  Blank lines and lines starting with '#' are skipped.
+
+		open|<name>|<savings or checking>
+		open|<name>|<savings or checking>|<address>|<telephone>|<age>|<adult, senior or student>
+		deposit|<account id>|<amount>
+		withdraw|<account id>|<amount>
+		list|<name>
+		interest
+		stats
+		stats|<file>
+
+	The short form of open adds an account for an existing customer; the long form also
+	creates the customer if there is none by that name.  Amounts are in dollars with at
+	most two decimals, e.g. 12.50.  interest runs the month-end interest on every account
+	(Bank::accrue_interest).  stats writes the bank's instrumentation report (see
+	Instrumentation.h) to out, or to the named file.  Results and errors are written to out,
+	which is never flushed here.
+
+	@param in	Where to read commands
+	@param out	Where to write results
+	@param bank	The bank to run them against
+	@return		The number of commands run (not counting skipped lines or lines with errors)
+*/
+size_t run_batch(std::istream &in, std::ostream &out, Bank &bank);
+
+#endif
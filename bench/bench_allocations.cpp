@@ -0,0 +1,46 @@
+/**
+	Replacement global operator new and delete that count allocations, see bench_allocations.h.
+	Every form of new and delete a program may call is replaced, so each block is freed by the
+	function matching the one that allocated it.
+*/
+
+#include <cstdlib>
+#include <new>
+#include "bench_allocations.h"
+
+std::atomic<long> allocations(0);
+std::atomic<long> allocated_bytes(0);
+
+void *operator new(std::size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	allocated_bytes.fetch_add((long)size, std::memory_order_relaxed);
+	if (void *p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+	std::free(p);
+}
@@ -0,0 +1,14 @@
+#ifndef BENCH_ALLOCATIONS_H_
+#define BENCH_ALLOCATIONS_H_
+#include <atomic>
+
+/**
+Heap allocations the program has made, for the benchmarks that report allocations per
+operation.  They are counted by the replacement global operator new in bench_allocations.cpp,
+which such a benchmark links in (see CMakeLists.txt).  The replacement lives in a file of its
+own so the compiler never sees its malloc and free inlined next to a library new or delete.
+*/
+extern std::atomic<long> allocations;		// Calls to operator new
+extern std::atomic<long> allocated_bytes;	// Bytes asked for by those calls
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef BENCH_AUDIT_H_
+#define BENCH_AUDIT_H_
+#include <algorithm>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+#include "../Bank.h"
+
+/**
+What the stress checks read back from the accounts' logs once a run is over
+*/
+struct Log_Audit
+{
+	int64_t fees;		// Check charges and overdraft penalties taken, in cents
+	size_t transfers;	// Transfer_Out legs recorded
+	bool legs_pair;		// Every Transfer_Out leg has a Transfer_In leg on the other account, for the same amount and time
+};
+
+/**
+Read the logs of the first accounts of a bank.  Nothing may be posting while this runs.
+@param bank		The bank
+@param accounts	How many accounts to read, from the first id on
+@return what the logs hold
+*/
+inline Log_Audit audit_logs(const Bank &bank, int accounts)
+{
+	// (from, to, amount, time) of each leg, to pair the two halves of every transfer
+	typedef std::tuple<int, int, int64_t, int64_t> Leg;
+	std::vector<Leg> sent, received;
+	int64_t fees = 0;
+	for (int i = 0; i < accounts; i++) {
+		int acct = 1001 + i;
+		for (const Transaction &tran : bank.get_account(acct)->get_transactions()) {
+			switch (tran.get_type()) {
+			case Transaction_Type::Check_Charge:
+			case Transaction_Type::Overdraft_Penalty:
+				fees += tran.get_amount().get_cents();
+				break;
+			case Transaction_Type::Transfer_Out:
+				sent.emplace_back(acct, tran.get_counterparty(), tran.get_amount().get_cents(), tran.get_timestamp());
+				break;
+			case Transaction_Type::Transfer_In:
+				received.emplace_back(tran.get_counterparty(), acct, tran.get_amount().get_cents(), tran.get_timestamp());
+				break;
+			default:
+				break;
+			}
+		}
+	}
+	std::sort(sent.begin(), sent.end());
+	std::sort(received.begin(), received.end());
+	return Log_Audit{fees, sent.size(), sent == received};
+}
+
+#endif
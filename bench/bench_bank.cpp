@@ -0,0 +1,210 @@
+/**
+	Baseline suite for the Bank and Account hot paths, to judge performance changes against.
+
+	Every benchmark runs against a populated bank, for each combination of
+	accounts (1k, 10k, 100k, 1M, 10M) and customers (one per account, or one per ten accounts).
+	The population is built once and shared by all the benchmarks of that size, which run
+	together; it is not timed.  Lookups and postings go to accounts and names picked at random.
+
+		GetAccount			Bank::get_account(int)
+		FindAccountsByName	Bank::get_account(name), i.e. find_accounts_by_name
+		MakeDeposit			Bank::make_deposit
+		MakeWithdrawal		Bank::make_withdrawal
+		AddInterest			Account::add_interest
+		ToString			Account::to_string
+		AddAccount			Bank::add_account(name, type), for existing customers
+		OnboardCustomer		Bank::add_account(name, address, ..., cust_type, type), for new customers
+
+	The two add_account benchmarks grow the bank, so they run last for each population and
+	make a fixed number of calls (a tenth of the accounts, at least 100).  The 10M populations
+	need several GB of memory; pick sizes with e.g. --benchmark_filter='accounts:100000/'.
+	Save a baseline with --benchmark_out=baseline.json (the bench_baseline target does this).
+*/
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "bench_population.h"
+
+// Random ids and names visited by each benchmark; enough ids that a large bank is not all in cache
+static const size_t ID_SAMPLES = 1 << 20;
+static const size_t NAME_SAMPLES = 1 << 16;
+
+/**
+	A bank with a given number of accounts and customers, and the ids and names to visit
+*/
+struct Population
+{
+	int accounts;
+	int customers;
+	Bank bank;
+	std::vector<int> ids;				// Random account ids
+	std::vector<std::string> names;		// Random customer names
+	int next_customer;					// For naming new customers
+
+	Population(int accounts_, int customers_) : accounts(accounts_), customers(customers_), next_customer(customers_)
+	{
+		// Customer i owns accounts i, i + customers, i + 2 * customers, ...
+		for (int i = 0; i < accounts; i++) {
+			std::string name = customer_name(i % customers);
+			const char *type = i % 2 ? "savings" : "checking";
+			if (i < customers)
+				bank.add_account(name, "1 Main St", "555-0100", 20 + i % 60, tier(i), type);
+			else
+				bank.add_account(name, type);
+		}
+
+		std::mt19937 rng(42);
+		ids.reserve(ID_SAMPLES);
+		for (size_t i = 0; i < ID_SAMPLES; i++)
+			ids.push_back(1001 + (int)(rng() % (unsigned)accounts));
+		names.reserve(NAME_SAMPLES);
+		for (size_t i = 0; i < NAME_SAMPLES; i++)
+			names.push_back(customer_name((int)(rng() % (unsigned)customers)));
+	}
+
+	static const char *tier(int i)
+	{
+		return i % 3 == 0 ? "adult" : i % 3 == 1 ? "senior" : "student";
+	}
+};
+
+/**
+	The population for a benchmark's arguments, building it (and dropping the last one) if needed
+	@param state The benchmark state; range(0) is the account count and range(1) the customer count
+	@return the population
+*/
+static Population &populate(const benchmark::State &state)
+{
+	static std::unique_ptr<Population> current;
+	int accounts = (int)state.range(0);
+	int customers = (int)state.range(1);
+	if (!current || current->accounts != accounts || current->customers != customers) {
+		current.reset();
+		current.reset(new Population(accounts, customers));
+	}
+	return *current;
+}
+
+static void BM_GetAccount(benchmark::State &state)
+{
+	Population &pop = populate(state);
+	size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(pop.bank.get_account(pop.ids[i]));
+		i = (i + 1) % ID_SAMPLES;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_FindAccountsByName(benchmark::State &state)
+{
+	Population &pop = populate(state);
+	size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(pop.bank.get_account(pop.names[i]));
+		i = (i + 1) % NAME_SAMPLES;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_MakeDeposit(benchmark::State &state)
+{
+	Population &pop = populate(state);
+	Money amt = Money::from_cents(2500);
+	size_t i = 0;
+	for (auto _ : state) {
+		pop.bank.make_deposit(pop.ids[i], amt);
+		i = (i + 1) % ID_SAMPLES;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_MakeWithdrawal(benchmark::State &state)
+{
+	Population &pop = populate(state);
+	Money amt = Money::from_cents(2000);
+	size_t i = 0;
+	for (auto _ : state) {
+		pop.bank.make_withdrawal(pop.ids[i], amt);
+		i = (i + 1) % ID_SAMPLES;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_AddInterest(benchmark::State &state)
+{
+	Population &pop = populate(state);
+	size_t i = 0;
+	for (auto _ : state) {
+		pop.bank.get_account(pop.ids[i])->add_interest();
+		i = (i + 1) % ID_SAMPLES;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_ToString(benchmark::State &state)
+{
+	Population &pop = populate(state);
+	size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(pop.bank.get_account(pop.ids[i])->to_string());
+		i = (i + 1) % ID_SAMPLES;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_AddAccount(benchmark::State &state)
+{
+	Population &pop = populate(state);
+	size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(pop.bank.add_account(pop.names[i], i % 2 ? "savings" : "checking"));
+		i = (i + 1) % NAME_SAMPLES;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_OnboardCustomer(benchmark::State &state)
+{
+	Population &pop = populate(state);
+	std::string name;
+	for (auto _ : state) {
+		state.PauseTiming();
+		name = customer_name(pop.next_customer++);
+		state.ResumeTiming();
+		benchmark::DoNotOptimize(pop.bank.add_account(name, "1 Main St", "555-0100", 40, "adult", "savings"));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+int main(int argc, char **argv)
+{
+	// Registered population by population, so each is built once and dropped before the next
+	for (int accounts : {1000, 10000, 100000, 1000000, 10000000}) {
+		for (int per_customer : {1, 10}) {
+			std::vector<int64_t> args = {accounts, accounts / per_customer};
+			int64_t growth = std::max(accounts / 10, 100);
+			auto add = [&args](const char *name, void (*fn)(benchmark::State &)) {
+				return benchmark::RegisterBenchmark(name, fn)->Args(args)->ArgNames({"accounts", "customers"});
+			};
+			add("BM_GetAccount", BM_GetAccount);
+			add("BM_FindAccountsByName", BM_FindAccountsByName);
+			add("BM_MakeDeposit", BM_MakeDeposit);
+			add("BM_MakeWithdrawal", BM_MakeWithdrawal);
+			add("BM_AddInterest", BM_AddInterest);
+			add("BM_ToString", BM_ToString);
+			add("BM_AddAccount", BM_AddAccount)->Iterations(growth);
+			add("BM_OnboardCustomer", BM_OnboardCustomer)->Iterations(growth);
+		}
+	}
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
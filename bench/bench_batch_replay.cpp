@@ -0,0 +1,54 @@
+/**
+	Throughput of the batch driver replaying a recorded day of traffic.
+
+	The command stream is generated once: it opens the given number of accounts, then makes
+	ten deposits or withdrawals per account, with every hundredth command a list.  Each
+	iteration replays the whole stream into a fresh bank, writing the results to a
+	discarded string buffer.
+*/
+
+#include <benchmark/benchmark.h>
+#include <random>
+#include <sstream>
+#include <string>
+#include "../Bank.h"
+#include "../batch_driver.h"
+
+static std::string make_commands(int accounts)
+{
+	std::mt19937 rng(99);
+	std::ostringstream cmds;
+	for (int i = 0; i < accounts; i++)
+		cmds << "open|Customer " << i << '|' << (i % 2 ? "savings" : "checking")
+			<< "|1 Main St|555-0100|40|adult\n";
+	for (int n = 0; n < accounts * 10; n++) {
+		int acct = 1001 + (int)(rng() % accounts);
+		if (n % 100 == 99)
+			cmds << "list|Customer " << acct - 1001 << '\n';
+		else if (n % 4 == 0)
+			cmds << "withdraw|" << acct << '|' << rng() % 100 << '.' << rng() % 10 << "0\n";
+		else
+			cmds << "deposit|" << acct << '|' << rng() % 100 << '.' << rng() % 10 << "0\n";
+	}
+	return cmds.str();
+}
+
+static void BM_BatchReplay(benchmark::State &state)
+{
+	int accounts = (int)state.range(0);
+	std::string commands = make_commands(accounts);
+	size_t run = 0;
+
+	for (auto _ : state) {
+		Bank bank;
+		std::istringstream in(commands);
+		std::ostringstream out;
+		run = run_batch(in, out, bank);
+		benchmark::DoNotOptimize(out);
+	}
+	state.SetItemsProcessed(state.iterations() * run);
+	state.SetBytesProcessed(state.iterations() * commands.size());
+}
+BENCHMARK(BM_BatchReplay)->RangeMultiplier(10)->Range(1000, 100000)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
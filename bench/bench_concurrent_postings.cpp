@@ -0,0 +1,181 @@
+/**
+	Multi-threaded stress benchmarks for a concurrent Bank.
+
+	"Postings": every thread makes deposits and withdrawals on accounts picked at random from
+	a shared bank.  Each thread keeps its own total of what it posted; once all threads are done,
+	the bank's total deposits must equal the sum of those totals, less the check charges and
+	overdraft fees the withdrawals took (which depend on the order postings land in, so they
+	are read back from the accounts' logs).
+
+	"Transfers": every thread moves money between random accounts, one transfer at a time and
+	in batches, with as many transfers in each direction, so the stripe locks are taken in
+	every order.  Transfers to the sending account, to or from unknown accounts, of nothing or
+	of more than the bank holds must be refused, and so must any batch holding one of them;
+	batches and single transfers short of funds may be refused too.  Once all threads are
+	done, the bank must hold what it opened with, no balance may be negative, and the logs must
+	hold exactly the transfers that were reported made, each with both legs.
+
+	Any lost, torn or wrongly allowed posting fails the run, and the program then exits with
+	status 1, so CTest runs it as a test (see CMakeLists.txt).  A deadlock hangs it until CTest
+	times it out.
+*/
+
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+#include "bench_audit.h"
+#include "bench_population.h"
+
+static const int ACCOUNTS = 1 << 16;
+
+static std::unique_ptr<Bank> bank;
+static std::atomic<int64_t> posted_cents(0);
+static std::atomic<int> finished(0);
+static bool unbalanced = false;		// Set once any run's books fail to add up
+
+static const int64_t OPENING_CENTS = 10000;		// What each account holds before the transfers
+static std::atomic<size_t> transfers_made(0);	// Transfers reported made, over all threads
+static std::atomic<bool> misjudged(false);		// A transfer that had to be refused was not
+
+static void BM_ConcurrentPostings(benchmark::State &state)
+{
+	// Thread 0 builds the bank; the other threads wait for it when they enter the loop
+	if (state.thread_index() == 0) {
+		bank.reset(new Bank(true));
+		open_accounts(*bank, ACCOUNTS);
+		posted_cents = 0;
+		finished = 0;
+	}
+
+	std::mt19937 rng(1234 + state.thread_index());
+	int64_t cents = 0;
+	for (auto _ : state) {
+		int acct = 1001 + (int)(rng() % ACCOUNTS);
+		Money amt = Money::from_cents(1 + rng() % 10000);
+		if (rng() % 4 == 0) {
+			bank->make_withdrawal(acct, amt);
+			cents -= amt.get_cents();
+		} else {
+			bank->make_deposit(acct, amt);
+			cents += amt.get_cents();
+		}
+	}
+	posted_cents += cents;
+	finished++;
+	state.SetItemsProcessed(state.iterations());
+
+	// Thread 0 checks the books once every thread has reported what it posted
+	if (state.thread_index() == 0) {
+		while (finished.load() < state.threads())
+			std::this_thread::yield();
+		if (bank->total_deposits().get_cents() != posted_cents.load() - audit_logs(*bank, ACCOUNTS).fees) {
+			state.SkipWithError("balances do not add up: postings were lost");
+			unbalanced = true;
+		}
+		bank.reset();
+	}
+}
+BENCHMARK(BM_ConcurrentPostings)->ThreadRange(1, 16)->UseRealTime();
+
+/**
+Check the books once every transfer has been made
+@return what is wrong, or NULL if nothing is
+*/
+static const char *audit_transfers()
+{
+	if (misjudged)
+		return "a transfer or batch that had to be refused was made";
+	if (bank->total_deposits().get_cents() != OPENING_CENTS * ACCOUNTS)
+		return "transfers did not conserve the bank's money";
+	for (int i = 0; i < ACCOUNTS; i++) {
+		if (bank->get_account(1001 + i)->get_balance() < Money())
+			return "a transfer overdrew an account";
+	}
+	Log_Audit logs = audit_logs(*bank, ACCOUNTS);
+	if (logs.transfers != transfers_made.load())
+		return "the logs do not hold the transfers reported made: part of a batch was applied";
+	if (!logs.legs_pair)
+		return "a transfer's legs do not pair up";
+	return NULL;
+}
+
+static void BM_ConcurrentTransfers(benchmark::State &state)
+{
+	// Thread 0 builds the bank; the other threads wait for it when they enter the loop
+	if (state.thread_index() == 0) {
+		bank.reset(new Bank(true));
+		open_accounts(*bank, ACCOUNTS);
+		for (int i = 0; i < ACCOUNTS; i++)
+			bank->make_deposit(1001 + i, Money::from_cents(OPENING_CENTS));
+		transfers_made = 0;
+		misjudged = false;
+		finished = 0;
+	}
+
+	std::mt19937 rng(5678 + state.thread_index());
+	const Money too_much = Money::from_cents(OPENING_CENTS * ACCOUNTS + 1);
+	size_t made = 0;
+	for (auto _ : state) {
+		int from = 1001 + (int)(rng() % ACCOUNTS);
+		int to = 1001 + (int)(rng() % ACCOUNTS);
+		int unknown = rng() % 2 ? 1001 + ACCOUNTS + (int)(rng() % 1000) : (int)(rng() % 1001);
+		Money amt = Money::from_cents(1 + rng() % 5000);
+		if (from == to)
+			to = from == 1000 + ACCOUNTS ? 1001 : from + 1;
+		switch (rng() % 8) {
+		case 0:
+			if (bank->transfer(from, from, amt) || bank->transfer(from, unknown, amt) || bank->transfer(unknown, to, amt)
+					|| bank->transfer(from, to, Money()) || bank->transfer(from, to, too_much))
+				misjudged = true;
+			break;
+		case 1:
+			// A good transfer followed by a bad one: neither may be made
+			if (bank->transfer({{from, to, amt}, {to, rng() % 2 ? to : unknown, amt}})
+					|| bank->transfer({{from, to, amt}, {to, from, too_much}}))
+				misjudged = true;
+			break;
+		case 2:
+		case 3: {
+			// Around a cycle, so the later legs can spend what the earlier ones brought in
+			int third = 1001 + (int)(rng() % ACCOUNTS);
+			if (third == from || third == to)
+				break;
+			if (bank->transfer({{from, to, amt}, {to, third, amt}, {third, from, amt}}))
+				made += 3;
+			break;
+		}
+		default:
+			if (bank->transfer(from, to, amt))
+				made++;
+			break;
+		}
+	}
+	transfers_made += made;
+	finished++;
+	state.SetItemsProcessed(state.iterations());
+
+	// Thread 0 checks the books once every thread is done
+	if (state.thread_index() == 0) {
+		while (finished.load() < state.threads())
+			std::this_thread::yield();
+		if (const char *wrong = audit_transfers()) {
+			state.SkipWithError(wrong);
+			unbalanced = true;
+		}
+		bank.reset();
+	}
+}
+BENCHMARK(BM_ConcurrentTransfers)->ThreadRange(1, 16)->UseRealTime();
+
+int main(int argc, char **argv)
+{
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return unbalanced ? 1 : 0;
+}
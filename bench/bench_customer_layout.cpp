@@ -0,0 +1,59 @@
+/**
+	Memory and allocations of customer records.
+
+	"Create" builds a customer with a name, address and telephone number, as add_customer
+	does, and reports the bytes and heap allocations each one costs: sizeof the record plus
+	whatever it puts on the heap.  Argument 0 uses typical text, which fits inside the record;
+	argument 1 uses a long address, which sends the text to one heap block.
+
+	"Lookup" finds the owner of an account, as a statement does, and reads back every field;
+	it reports the allocations per lookup.  The fields are views, so there should be none
+	(the old string-returning getters made a copy of each).
+
+	Allocations are counted by the replacement operator new in bench_allocations.cpp.
+*/
+
+#include <benchmark/benchmark.h>
+#include <string>
+#include "bench_allocations.h"
+#include "../Bank.h"
+
+static void BM_CustomerCreate(benchmark::State &state)
+{
+	const std::string name = "Margaret Whitworth";
+	const std::string address = state.range(0) ? "1200 West Hawthorne Road, Apartment 14B, Spokane WA 99201" : "12 Elm St";
+	const std::string telephone = "509-777-1000";
+	long before = allocations.load();
+	long bytes_before = allocated_bytes.load();
+	for (auto _ : state) {
+		Customer *cust = new Adult(1001, name);
+		cust->set_address(address);
+		cust->set_telephone_number(telephone);
+		cust->set_age(40);
+		benchmark::DoNotOptimize(cust);
+		delete cust;
+	}
+	state.counters["allocs_per_customer"] = (double)(allocations.load() - before) / state.iterations();
+	state.counters["bytes_per_customer"] = (double)(allocated_bytes.load() - bytes_before) / state.iterations();
+	state.counters["sizeof_customer"] = sizeof(Adult);
+}
+BENCHMARK(BM_CustomerCreate)->Arg(0)->Arg(1);
+
+static void BM_CustomerLookup(benchmark::State &state)
+{
+	Bank bank;
+	for (int i = 0; i < 10000; i++)
+		bank.add_account("Customer " + std::to_string(i), "12 Elm St", "509-777-1000", 40, "adult", "savings");
+	long before = allocations.load();
+	size_t chars = 0;
+	for (auto _ : state) {
+		Customer *found = bank.get_account(1001 + 5000)->get_customer();
+		chars += found->get_name().size() + found->get_address().size()
+				+ found->get_telephone_number().size() + found->get_cust_type().size();
+		benchmark::DoNotOptimize(chars);
+	}
+	state.counters["allocs_per_lookup"] = (double)(allocations.load() - before) / state.iterations();
+}
+BENCHMARK(BM_CustomerLookup);
+
+BENCHMARK_MAIN();
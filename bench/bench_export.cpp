@@ -0,0 +1,58 @@
+/**
+	Nightly extract: columnar export against formatting every account with to_string().
+
+	The bank has the given number of accounts, one customer per two accounts and five
+	postings per account.  "Columnar" writes accounts, customers and transactions with
+	Columnar_Export; "ToString" writes to_string() of every account plus process_tran() of every
+	transaction to a file.  Both write to a temporary file.
+*/
+
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include "bench_population.h"
+#include "../Columnar_Export.h"
+
+static std::unique_ptr<Bank> make_bank(int accounts)
+{
+	std::unique_ptr<Bank> bank(new Bank);
+	open_accounts(*bank, accounts, 2);
+	for (int n = 0; n < 5; n++)
+		for (int i = 0; i < accounts; i++)
+			bank->get_account(1001 + i)->post_interest(Money::from_cents(100 + n));
+	return bank;
+}
+
+static void BM_ExportColumnar(benchmark::State &state)
+{
+	std::unique_ptr<Bank> bank = make_bank((int)state.range(0));
+	std::string path = "/tmp/bench_export.cols";
+	uint64_t bytes = 0;
+	for (auto _ : state)
+		bytes = Columnar_Export::write(*bank, path).bytes;
+	state.SetBytesProcessed(state.iterations() * bytes);
+	std::remove(path.c_str());
+}
+BENCHMARK(BM_ExportColumnar)->RangeMultiplier(10)->Range(1000, 100000)->Unit(benchmark::kMillisecond);
+
+static void BM_ExportToString(benchmark::State &state)
+{
+	int accounts = (int)state.range(0);
+	std::unique_ptr<Bank> bank = make_bank(accounts);
+	std::string path = "/tmp/bench_export.txt";
+	for (auto _ : state) {
+		std::ofstream out(path);
+		for (int i = 0; i < accounts; i++) {
+			Account *acct = bank->get_account(1001 + i);
+			out << acct->to_string();
+			for (const Transaction &tran : acct->get_transactions())
+				out << tran.process_tran() << '\n';
+		}
+	}
+	std::remove(path.c_str());
+}
+BENCHMARK(BM_ExportToString)->RangeMultiplier(10)->Range(1000, 100000)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,51 @@
+/**
+	Benchmark for Bank::get_account(int).
+
+	Fills a bank with a growing number of accounts and measures the cost of
+	looking up random account ids.  The lookup cost should stay flat as the
+	account count grows from 1k to 8M.
+*/
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "../Bank.h"
+
+/**
+	Build a bank holding the requested number of accounts, all owned by one customer
+	@param bank	Bank object to fill
+	@param count	Number of accounts to open
+	@return the ids of the accounts that were opened
+*/
+static std::vector<int> fill_bank(Bank &bank, int count)
+{
+	std::vector<int> ids;
+	ids.reserve(count);
+	Account *acct = bank.add_account("Bench Customer", "1 Main St", "555-0100", 30, "adult", "checking");
+	ids.push_back(acct->get_account());
+	for (int i = 1; i < count; i++)
+		ids.push_back(bank.add_account("Bench Customer", i % 2 ? "savings" : "checking")->get_account());
+	return ids;
+}
+
+static void BM_GetAccount(benchmark::State &state)
+{
+	Bank bank;
+	std::vector<int> ids = fill_bank(bank, (int)state.range(0));
+
+	// Visit accounts in random order so the benchmark is not just streaming the vector
+	std::mt19937 rng(42);
+	std::shuffle(ids.begin(), ids.end(), rng);
+
+	size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(bank.get_account(ids[i]));
+		if (++i == ids.size())
+			i = 0;
+	}
+	state.counters["accounts"] = (double)ids.size();
+}
+BENCHMARK(BM_GetAccount)->RangeMultiplier(8)->Range(1 << 10, 1 << 23);
+
+BENCHMARK_MAIN();
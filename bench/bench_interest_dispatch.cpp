@@ -0,0 +1,104 @@
+/**
+	Benchmark comparing the two ways of finding a customer's interest rate.
+
+	"Virtual" reproduces the original layout, where every customer object carried its own
+	rate and fee constants and the rate was fetched through a virtual getter.  "Table" uses the
+	current Customer, whose rate is a load from the constexpr TIER_SCHEDULES table.
+	Each benchmark iteration performs 10M interest calculations over a mixed population
+	of adults, seniors and students.
+*/
+
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <random>
+#include <vector>
+#include "../Customer.h"
+
+static const int POPULATION = 1 << 18;
+static const int CALCULATIONS = 10000000;
+
+// The original per-instance, virtual-getter customer types
+class Virtual_Customer {
+public:
+	virtual ~Virtual_Customer() {}
+	virtual const Rate get_savings_interest() = 0;
+};
+
+class Virtual_Adult : public Virtual_Customer {
+public:
+	const Rate SAVINGS_INTEREST = Rate::from_ppm(30000);
+	const Rate CHECK_INTEREST = Rate::from_ppm(30000);
+	const Money CHECK_CHARGE = Money::from_cents(150);
+	const Money OVERDRAFT_PENALTY = Money::from_cents(3500);
+	const Rate get_savings_interest() { return SAVINGS_INTEREST; }
+};
+
+class Virtual_Senior : public Virtual_Customer {
+public:
+	const Rate SAVINGS_INTEREST = Rate::from_ppm(50000);
+	const Rate CHECK_INTEREST = Rate::from_ppm(10000);
+	const Money CHECK_CHARGE = Money::from_cents(200);
+	const Money OVERDRAFT_PENALTY = Money::from_cents(2500);
+	const Rate get_savings_interest() { return SAVINGS_INTEREST; }
+};
+
+class Virtual_Student : public Virtual_Customer {
+public:
+	const Rate SAVINGS_INTEREST = Rate::from_ppm(10000);
+	const Rate CHECK_INTEREST = Rate::from_ppm(50000);
+	const Money CHECK_CHARGE = Money::from_cents(100);
+	const Money OVERDRAFT_PENALTY = Money::from_cents(2500);
+	const Rate get_savings_interest() { return SAVINGS_INTEREST; }
+};
+
+static void BM_InterestVirtual(benchmark::State &state)
+{
+	std::mt19937 rng(7);
+	std::vector<std::unique_ptr<Virtual_Customer>> customers;
+	for (int i = 0; i < POPULATION; i++) {
+		switch (rng() % 3) {
+		case 0: customers.emplace_back(new Virtual_Adult()); break;
+		case 1: customers.emplace_back(new Virtual_Senior()); break;
+		default: customers.emplace_back(new Virtual_Student()); break;
+		}
+	}
+	std::vector<Money> balances(POPULATION, Money::from_cents(100000));
+
+	for (auto _ : state) {
+		Money total;
+		for (int n = 0; n < CALCULATIONS; n++) {
+			int i = n & (POPULATION - 1);
+			total += balances[i].times(customers[i]->get_savings_interest());
+		}
+		benchmark::DoNotOptimize(total);
+	}
+	state.SetItemsProcessed(state.iterations() * CALCULATIONS);
+}
+BENCHMARK(BM_InterestVirtual)->Unit(benchmark::kMillisecond);
+
+static void BM_InterestTable(benchmark::State &state)
+{
+	std::mt19937 rng(7);
+	std::vector<std::unique_ptr<Customer>> customers;
+	for (int i = 0; i < POPULATION; i++) {
+		switch (rng() % 3) {
+		case 0: customers.emplace_back(new Adult(i, "")); break;
+		case 1: customers.emplace_back(new Senior(i, "")); break;
+		default: customers.emplace_back(new Student(i, "")); break;
+		}
+	}
+	std::vector<Money> balances(POPULATION, Money::from_cents(100000));
+
+	for (auto _ : state) {
+		Money total;
+		for (int n = 0; n < CALCULATIONS; n++) {
+			int i = n & (POPULATION - 1);
+			total += balances[i].times(customers[i]->get_savings_interest());
+		}
+		benchmark::DoNotOptimize(total);
+	}
+	state.SetItemsProcessed(state.iterations() * CALCULATIONS);
+}
+BENCHMARK(BM_InterestTable)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,42 @@
+/**
+	Sustained journaling throughput.
+
+	Appends postings to a Journal in a temporary directory, with a background group commit
+	every few milliseconds (the argument, 0 meaning a single commit per iteration).  Each
+	iteration appends APPENDS records and then commits, so the time includes getting
+	every record to disk.
+*/
+
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <string>
+#include "../Journal.h"
+
+static const int APPENDS = 1 << 20;
+
+static void BM_JournalAppend(benchmark::State &state)
+{
+	char dir[] = "/tmp/bench_journal.XXXXXX";
+	if (mkdtemp(dir) == NULL) {
+		state.SkipWithError("cannot create a temporary directory");
+		return;
+	}
+	std::string path = std::string(dir) + "/journal";
+	{
+		Journal journal(path, (unsigned)state.range(0));
+		Transaction tran(1001, Transaction_Type::Deposit, Money::from_cents(100),
+				Money::from_cents(150), Money::from_cents(3500));
+		int acct = 1001;
+		for (auto _ : state) {
+			for (int i = 0; i < APPENDS; i++)
+				journal.append(acct + (i & 0xffff), tran);
+			journal.commit();
+		}
+		state.SetItemsProcessed(state.iterations() * APPENDS);
+		state.SetBytesProcessed(state.iterations() * APPENDS * sizeof(Journal_Record));
+	}
+	std::system(("rm -rf " + std::string(dir)).c_str());
+}
+BENCHMARK(BM_JournalAppend)->Arg(0)->Arg(2)->Arg(10)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,48 @@
+#ifndef BENCH_POPULATION_H_
+#define BENCH_POPULATION_H_
+#include <string>
+#include "../Bank.h"
+
+/**
+The synthetic customers the benchmarks fill a bank with.
+*/
+
+/**
+@param i	The customer's index in the population
+@return the name of that customer
+*/
+inline std::string customer_name(int i)
+{
+	return "Customer " + std::to_string(i);
+}
+
+/**
+Open accounts for new adult customers, alternating checking and savings.
+@param bank					The bank to fill
+@param accounts				How many accounts to open
+@param accounts_per_name	How many consecutive accounts share a customer name; each still
+							gets a customer of its own, as add_account with full details does
+*/
+inline void open_accounts(Bank &bank, int accounts, int accounts_per_name = 1)
+{
+	for (int i = 0; i < accounts; i++)
+		bank.add_account(customer_name(i / accounts_per_name), "1 Main St", "555-0100", 40, "adult",
+				i % 2 ? "savings" : "checking");
+}
+
+/**
+Open accounts that all belong to one new adult customer, alternating checking and savings:
+the first with the customer's details, the rest by name.
+@param bank		The bank to fill
+@param name		The customer's name
+@param address	The customer's address
+@param accounts	How many accounts to open
+*/
+inline void open_customer_accounts(Bank &bank, const std::string &name, const std::string &address, int accounts)
+{
+	bank.add_account(name, address, "555-0100", 40, "adult", "checking");
+	for (int i = 1; i < accounts; i++)
+		bank.add_account(name, i % 2 ? "savings" : "checking");
+}
+
+#endif
@@ -0,0 +1,86 @@
+/**
+	Throughput of the two ways of getting postings into a bank.
+
+	"Direct" has every producer call Bank::make_deposit/make_withdrawal on a concurrent
+	Bank, applying each posting at the call site under its account's stripe lock.
+	"Sharded" has the producers push the same postings into a Sharded_Bank, whose workers
+	apply them in batches grouped by account.  Each iteration posts POSTINGS postings to
+	random accounts from the given number of producer threads and waits until all of them
+	are applied, so both timings cover the full trip.
+*/
+
+#include <benchmark/benchmark.h>
+#include <random>
+#include <thread>
+#include <vector>
+#include "bench_population.h"
+#include "../Sharded_Bank.h"
+
+static const int ACCOUNTS = 1 << 16;
+static const int POSTINGS = 1 << 20;
+
+// Account ids and amounts, drawn up front so the timings leave out the random number generator
+static std::vector<int> draw_accounts()
+{
+	std::mt19937 rng(42);
+	std::vector<int> accts(POSTINGS);
+	for (int &acct : accts)
+		acct = 1001 + (int)(rng() % ACCOUNTS);
+	return accts;
+}
+
+// Run one producer per thread, each taking an equal slice of the postings
+template <typename Post>
+static void produce(int producers, Post post)
+{
+	std::vector<std::thread> threads;
+	for (int t = 0; t < producers; t++)
+		threads.emplace_back([=]() {
+			for (int i = t; i < POSTINGS; i += producers)
+				post(i);
+		});
+	for (std::thread &thread : threads)
+		thread.join();
+}
+
+static void BM_PostDirect(benchmark::State &state)
+{
+	Bank bank(true);
+	open_accounts(bank, ACCOUNTS);
+	std::vector<int> accts = draw_accounts();
+	int producers = (int)state.range(0);
+
+	for (auto _ : state) {
+		produce(producers, [&](int i) {
+			if (i % 4 == 0)
+				bank.make_withdrawal(accts[i], Money::from_cents(100));
+			else
+				bank.make_deposit(accts[i], Money::from_cents(100));
+		});
+	}
+	state.SetItemsProcessed(state.iterations() * POSTINGS);
+}
+BENCHMARK(BM_PostDirect)->RangeMultiplier(2)->Range(1, 8)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_PostSharded(benchmark::State &state)
+{
+	Bank bank(true);
+	open_accounts(bank, ACCOUNTS);
+	std::vector<int> accts = draw_accounts();
+	int producers = (int)state.range(0);
+	Sharded_Bank sharded(bank, 4);
+
+	for (auto _ : state) {
+		produce(producers, [&](int i) {
+			if (i % 4 == 0)
+				sharded.make_withdrawal(accts[i], Money::from_cents(100));
+			else
+				sharded.make_deposit(accts[i], Money::from_cents(100));
+		});
+		sharded.drain();
+	}
+	state.SetItemsProcessed(state.iterations() * POSTINGS);
+}
+BENCHMARK(BM_PostSharded)->RangeMultiplier(2)->Range(1, 8)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,177 @@
+/**
+	Multi-threaded stress benchmark for a Sharded_Bank, checked the way bench_concurrent_postings is.
+
+	"Postings": every thread queues deposits, withdrawals and transfers between random accounts,
+	most of which cross shards, plus a known number of postings that must be rejected (unknown
+	accounts, transfers to the sending account or of nothing).  Every account opens with more
+	money than a run can take out, so no valid transfer is short of funds.  After drain(), the
+	bank's total must be the opening money plus what was deposited, less what was withdrawn and
+	the check charges those withdrawals took; the rejected count must be the number of bad
+	postings sent; and every Transfer_Out leg must have a Transfer_In leg on the other account,
+	for the same amount and time.
+
+	"DrainTransfer": a transfer from an account on the last shard to one on the first, then
+	drain().  The credit must have landed by the time drain() returns.
+
+	A failed check fails the run, and the program then exits with status 1, so CTest runs it
+	as a test (see CMakeLists.txt).
+*/
+
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <thread>
+#include "bench_audit.h"
+#include "bench_population.h"
+#include "../Sharded_Bank.h"
+
+static const int ACCOUNTS = 1 << 16;
+static const unsigned SHARDS = 8;
+static const int64_t OPENING_CENTS = 1000000000000;	// Per account; far more than a run can move
+
+static std::unique_ptr<Bank> bank;
+static std::unique_ptr<Sharded_Bank> sharded;
+static std::atomic<int64_t> posted_cents(0);		// Deposits less withdrawals, over all threads
+static std::atomic<size_t> bad_postings(0);			// Postings sent that must be rejected
+static std::atomic<size_t> transfers_sent(0);		// Valid transfers sent
+static std::atomic<int> finished(0);
+static bool unbalanced = false;		// Set once any check fails
+
+/**
+@return a bank of ACCOUNTS accounts, each holding OPENING_CENTS
+*/
+static Bank *open_bank()
+{
+	Bank *opened = new Bank(true);
+	open_accounts(*opened, ACCOUNTS);
+	for (int i = 0; i < ACCOUNTS; i++)
+		opened->make_deposit(1001 + i, Money::from_cents(OPENING_CENTS));
+	return opened;
+}
+
+/**
+Check the books once every posting has been applied
+@return what is wrong, or NULL if nothing is
+*/
+static const char *audit()
+{
+	Log_Audit logs = audit_logs(*bank, ACCOUNTS);
+	if (bank->total_deposits().get_cents() != OPENING_CENTS * ACCOUNTS + posted_cents.load() - logs.fees)
+		return "balances do not add up: postings were lost";
+	if (sharded->rejected_postings() != bad_postings.load())
+		return "the wrong number of postings were rejected";
+	if (logs.transfers != transfers_sent.load())
+		return "the wrong number of transfers were made";
+	if (!logs.legs_pair)
+		return "a transfer's legs do not pair up";
+	return NULL;
+}
+
+static void BM_ShardedPostings(benchmark::State &state)
+{
+	// Thread 0 builds the bank; the other threads wait for it when they enter the loop
+	if (state.thread_index() == 0) {
+		bank.reset(open_bank());
+		sharded.reset(new Sharded_Bank(*bank, SHARDS));
+		posted_cents = 0;
+		bad_postings = 0;
+		transfers_sent = 0;
+		finished = 0;
+	}
+
+	std::mt19937 rng(4321 + state.thread_index());
+	int64_t cents = 0;
+	size_t bad = 0, transfers = 0;
+	for (auto _ : state) {
+		int acct = 1001 + (int)(rng() % ACCOUNTS);
+		int other = 1001 + (int)(rng() % ACCOUNTS);
+		Money amt = Money::from_cents(1 + rng() % 10000);
+		switch (rng() % 16) {
+		case 0:
+			sharded->make_deposit(1001 + ACCOUNTS + (int)(rng() % 1000), amt);
+			bad++;
+			break;
+		case 1:
+			sharded->transfer(acct, acct, amt);
+			bad++;
+			break;
+		case 2:
+			sharded->transfer(acct, other == acct ? acct + 1 : other, Money());
+			bad++;
+			break;
+		case 3:
+		case 4:
+		case 5:
+			sharded->make_withdrawal(acct, amt);
+			cents -= amt.get_cents();
+			break;
+		case 6:
+		case 7:
+		case 8:
+		case 9:
+			if (other == acct) {
+				sharded->make_deposit(acct, amt);
+				cents += amt.get_cents();
+				break;
+			}
+			sharded->transfer(acct, other, amt);
+			transfers++;
+			break;
+		default:
+			sharded->make_deposit(acct, amt);
+			cents += amt.get_cents();
+			break;
+		}
+	}
+	posted_cents += cents;
+	bad_postings += bad;
+	transfers_sent += transfers;
+	finished++;
+	state.SetItemsProcessed(state.iterations());
+
+	// Thread 0 checks the books once every thread has sent all it is going to
+	if (state.thread_index() == 0) {
+		while (finished.load() < state.threads())
+			std::this_thread::yield();
+		sharded->drain();
+		if (const char *wrong = audit()) {
+			state.SkipWithError(wrong);
+			unbalanced = true;
+		}
+		sharded.reset();
+		bank.reset();
+	}
+}
+BENCHMARK(BM_ShardedPostings)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_DrainTransfer(benchmark::State &state)
+{
+	std::unique_ptr<Bank> owner(open_bank());
+	Sharded_Bank shards(*owner, SHARDS);
+	// The last account is in the last block, which belongs to the last shard; the first is on shard 0
+	int from = 1000 + ACCOUNTS, to = 1001;
+	Account *dest = owner->get_account(to);
+	Money expected = dest->get_balance();
+	for (auto _ : state) {
+		shards.transfer(from, to, Money::from_cents(1));
+		shards.drain();
+		expected += Money::from_cents(1);
+		if (dest->get_balance() != expected) {
+			state.SkipWithError("drain() returned before a transfer's credit was applied");
+			unbalanced = true;
+			break;
+		}
+	}
+}
+BENCHMARK(BM_DrainTransfer);
+
+int main(int argc, char **argv)
+{
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return unbalanced ? 1 : 0;
+}
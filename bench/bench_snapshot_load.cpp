@@ -0,0 +1,212 @@
+/**
+	Cold start of a bank from a snapshot plus journal, against rebuilding it with add_account.
+
+	Setup builds a bank with the given number of accounts (two per customer), journals one
+	deposit per account, snapshots it and then journals one more deposit per account.
+	"Snapshot" loads the snapshot and replays that journal tail into a fresh bank;
+	"Rebuild" opens the same accounts through the public add_account calls.
+
+	"Restart" is also a check of the round trip.  Setup journals deposits, withdrawals (with
+	their fees), transfers and interest on either side of a snapshot, then tears the last
+	journal record as a crash mid-write would.  Each load must give back every balance as it
+	was before the torn posting, and each account as many records as it had postings since the
+	snapshot.  A journal naming an account opened after the snapshot must be refused.  A
+	failed check fails the run, and the program then exits with status 1, so CTest runs it as
+	a test (see CMakeLists.txt).
+*/
+
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "bench_population.h"
+#include "../Snapshot.h"
+
+static bool failed = false;		// Set once any round-trip check fails
+
+static void BM_LoadSnapshot(benchmark::State &state)
+{
+	int accounts = (int)state.range(0);
+	char dir[] = "/tmp/bench_snapshot.XXXXXX";
+	if (mkdtemp(dir) == NULL) {
+		state.SkipWithError("cannot create a temporary directory");
+		return;
+	}
+	std::string snapshot = std::string(dir) + "/bank.snap";
+	std::string journal_path = std::string(dir) + "/journal";
+	{
+		Journal journal(journal_path);
+		Bank bank;
+		bank.set_journal(&journal);
+		open_accounts(bank, accounts, 2);
+		for (int i = 0; i < accounts; i++)
+			bank.get_account(1001 + i)->post_interest(Money::from_cents(100));
+		Snapshot::save(bank, snapshot);
+		for (int i = 0; i < accounts; i++)
+			bank.get_account(1001 + i)->post_interest(Money::from_cents(100));
+	}
+
+	for (auto _ : state) {
+		std::unique_ptr<Bank> bank(new Bank);
+		Snapshot::Load_Result result = Snapshot::load(*bank, snapshot, journal_path);
+		benchmark::DoNotOptimize(result);
+		state.PauseTiming();	// Leave tearing the bank down out of the timing
+		bank.reset();
+		state.ResumeTiming();
+	}
+	state.SetItemsProcessed(state.iterations() * accounts);
+	std::system(("rm -rf " + std::string(dir)).c_str());
+}
+BENCHMARK(BM_LoadSnapshot)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMillisecond);
+
+static void BM_Rebuild(benchmark::State &state)
+{
+	int accounts = (int)state.range(0);
+	for (auto _ : state) {
+		std::unique_ptr<Bank> bank(new Bank);
+		open_accounts(*bank, accounts, 2);
+		benchmark::DoNotOptimize(bank->get_account(1001));
+		state.PauseTiming();
+		bank.reset();
+		state.ResumeTiming();
+	}
+	state.SetItemsProcessed(state.iterations() * accounts);
+}
+BENCHMARK(BM_Rebuild)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMillisecond);
+
+/**
+Make a round of every kind of posting, on each account in turn
+@param bank		The bank
+@param accounts	How many accounts it has
+@param round	Which round this is, to vary the amounts
+*/
+static void post_round(Bank &bank, int accounts, int round)
+{
+	for (int i = 0; i < accounts; i++) {
+		int acct = 1001 + i;
+		bank.make_deposit(acct, Money::from_cents(5000 + 7 * i + round));
+		bank.make_withdrawal(acct, Money::from_cents(100 * (i % 90)));	// Some go overdrawn and pay the penalty
+		bank.transfer(acct, 1001 + (i * 31 + round) % accounts, Money::from_cents(1 + i % 500));
+		if (i % 3 == 0)
+			bank.get_account(acct)->post_interest(Money::from_cents(i % 17));
+	}
+}
+
+/**
+Tear one journal record, as a crash partway through writing it would
+@param journal_path	Base path of the journal
+@param sequence		The record to tear
+*/
+static void tear(const std::string &journal_path, uint64_t sequence)
+{
+	std::string name = journal_path + "." + std::to_string(sequence / Journal::SEGMENT_RECORDS);
+	FILE *file = std::fopen(name.c_str(), "r+b");
+	if (file == NULL)
+		throw std::runtime_error("cannot open " + name);
+	long offset = (long)(Journal::HEADER_SIZE + (sequence % Journal::SEGMENT_RECORDS) * sizeof(Journal_Record)
+			+ offsetof(Journal_Record, tran));
+	const unsigned char garbage[8] = {0xde, 0xad, 0xbe, 0xef, 0xde, 0xad, 0xbe, 0xef};
+	bool ok = std::fseek(file, offset, SEEK_SET) == 0 && std::fwrite(garbage, 1, sizeof(garbage), file) == sizeof(garbage);
+	if (std::fclose(file) != 0 || !ok)
+		throw std::runtime_error("cannot tear a record in " + name);
+}
+
+static void BM_Restart(benchmark::State &state)
+{
+	int accounts = (int)state.range(0);
+	char dir[] = "/tmp/bench_snapshot.XXXXXX";
+	if (mkdtemp(dir) == NULL) {
+		state.SkipWithError("cannot create a temporary directory");
+		return;
+	}
+	std::string snapshot = std::string(dir) + "/bank.snap";
+	std::string journal_path = std::string(dir) + "/journal";
+	std::string late_journal_path = std::string(dir) + "/late";
+
+	// What each account should hold after a restart, and how many records it should get back
+	std::vector<Money> balances(accounts);
+	std::vector<size_t> records(accounts);
+	uint64_t torn;
+	{
+		Journal journal(journal_path);
+		Bank bank;
+		bank.set_journal(&journal);
+		open_accounts(bank, accounts, 2);
+		post_round(bank, accounts, 0);
+		Snapshot::save(bank, snapshot);
+		for (int i = 0; i < accounts; i++)
+			records[i] = bank.get_account(1001 + i)->get_transactions().size();
+		post_round(bank, accounts, 1);
+		for (int i = 0; i < accounts; i++) {
+			Account *acct = bank.get_account(1001 + i);
+			balances[i] = acct->get_balance();
+			records[i] = acct->get_transactions().size() - records[i];
+		}
+		bank.make_deposit(1001, Money::from_cents(12345));	// Lost to the tear below
+		torn = journal.size() - 1;
+	}
+	tear(journal_path, torn);
+	{
+		// A journal that goes on to an account the snapshot does not have
+		Journal journal(late_journal_path);
+		Bank bank;
+		bank.set_journal(&journal);
+		open_accounts(bank, accounts, 2);
+		Snapshot::save(bank, snapshot + ".late");
+		bank.make_deposit(1001 + accounts - 1, Money::from_cents(100));
+		open_accounts(bank, 1);
+		bank.make_deposit(1001 + accounts, Money::from_cents(100));
+	}
+
+	for (auto _ : state) {
+		std::unique_ptr<Bank> bank(new Bank);
+		Snapshot::Load_Result result = Snapshot::load(*bank, snapshot, journal_path);
+		state.PauseTiming();
+		const char *wrong = NULL;
+		for (int i = 0; i < accounts && wrong == NULL; i++) {
+			Account *acct = bank->get_account(1001 + i);
+			if (acct == NULL || acct->get_balance() != balances[i])
+				wrong = "a balance is not what it was before the restart";
+			else if (acct->get_transactions().size() != records[i])
+				wrong = "an account did not get back the records posted since the snapshot";
+		}
+		if (wrong == NULL && bank->get_account(1001 + accounts) != NULL)
+			wrong = "the restarted bank has an account it never opened";
+
+		std::unique_ptr<Bank> late(new Bank);
+		try {
+			Snapshot::load(*late, snapshot + ".late", late_journal_path);
+			if (wrong == NULL)
+				wrong = "a journal naming an account opened after the snapshot was replayed";
+		} catch (const std::runtime_error &) {
+			if (wrong == NULL && late->get_account(1001) != NULL)
+				wrong = "a refused load left accounts in the bank";
+		}
+		if (wrong) {
+			state.SkipWithError(wrong);
+			failed = true;
+			break;
+		}
+		benchmark::DoNotOptimize(result);
+		bank.reset();
+		late.reset();
+		state.ResumeTiming();
+	}
+	state.SetItemsProcessed(state.iterations() * accounts);
+	std::system(("rm -rf " + std::string(dir)).c_str());
+}
+BENCHMARK(BM_Restart)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+int main(int argc, char **argv)
+{
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return failed ? 1 : 0;
+}
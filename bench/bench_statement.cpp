@@ -0,0 +1,54 @@
+/**
+	Rendering the statement of a customer with 50 accounts.
+
+	"ToString" is the old List_Account path: look up the customer's account ids, then
+	to_string() each account into an ostringstream.  "Render" is Bank::render_statement into a
+	reused buffer.  Both report the heap allocations made per statement, counted by the
+	replacement operator new in bench_allocations.cpp; the rendered path should make none.
+*/
+
+#include <benchmark/benchmark.h>
+#include <sstream>
+#include <string>
+#include "bench_allocations.h"
+#include "bench_population.h"
+
+static const int ACCOUNTS = 50;
+static const char *const OWNER = "Margaret Hamilton-Whitworth";
+
+static void BM_StatementToString(benchmark::State &state)
+{
+	Bank bank;
+	open_customer_accounts(bank, OWNER, "1200 West Hawthorne Road, Spokane WA", ACCOUNTS);
+	long before = allocations.load();
+	for (auto _ : state) {
+		std::ostringstream out;
+		std::vector<int> list = bank.get_account(OWNER);
+		for (size_t i = 0; i < list.size(); i++) {
+			out << bank.get_account(list[i])->to_string();
+			out << "---------------------------\n";
+		}
+		out << "Total " << list.size() << " accounts found\n";
+		benchmark::DoNotOptimize(out);
+	}
+	state.counters["allocs_per_statement"] = (double)(allocations.load() - before) / state.iterations();
+}
+BENCHMARK(BM_StatementToString);
+
+static void BM_StatementRender(benchmark::State &state)
+{
+	Bank bank;
+	open_customer_accounts(bank, OWNER, "1200 West Hawthorne Road, Spokane WA", ACCOUNTS);
+	std::string statement;
+	bank.render_statement(OWNER, statement);	// Let the buffer grow once
+	long before = allocations.load();
+	for (auto _ : state) {
+		statement.clear();
+		bank.render_statement(OWNER, statement);
+		benchmark::DoNotOptimize(statement.data());
+	}
+	state.counters["allocs_per_statement"] = (double)(allocations.load() - before) / state.iterations();
+}
+BENCHMARK(BM_StatementRender);
+
+BENCHMARK_MAIN();
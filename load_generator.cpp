@@ -0,0 +1,520 @@
+/**
+	Synthetic load generator: drives a Bank with a seeded, repeatable mix of traffic, to size
+	hardware and to reproduce production-scale behaviour offline.
+
+	It first opens a population of accounts, with a given number of accounts per customer and an
+	opening deposit in each, then makes a number of operations split evenly over the months
+	and the threads.  Each operation is one of
+
+		deposit		Bank::make_deposit to an account
+		withdrawal	Bank::make_withdrawal from an account (fees included)
+		lookup		a customer's statement by name, Bank::render_statement
+		onboard		a new customer, Bank::add_account(name, address, ..., cust_type, account_type)
+
+	picked according to the mix.  Deposits, withdrawals and lookups go to accounts of the
+	population picked with a Zipf distribution: the k-th most popular account is picked in
+	proportion to 1 / k^s, and the popular accounts are scattered over the id range rather than
+	all at the front.  A lookup is for the owner of the picked account.  At the end of every
+	month the bank runs its month-end interest (Bank::accrue_interest).
+
+	Every thread draws its operations from its own mt19937_64 stream, seeded from the seed and
+	the thread number, and all the arithmetic on the draws is done here rather than by the
+	standard library's distributions, so the same options produce the same operations on any
+	platform.  With more than one thread the order in which threads reach the bank still varies.
+
+	Either the operations are run straight against a Bank and the throughput and latency
+	percentiles of each kind are reported, or (--replay) they are written out as batch commands
+	(see batch_driver.h) without running anything: the population, then each month's operations
+	thread by thread, then interest.  Replaying that file with banking_application --batch
+	makes the same calls on one thread; with --threads 1 it leaves the same balances as a
+	direct run.
+
+	Usage: load_generator [options]
+		--seed N			Seed for every random choice (default 1)
+		--threads N			Threads calling the bank at once (default 1)
+		--accounts N		Accounts opened before the run (default 100000)
+		--per-customer N	Accounts per customer in that population (default 2)
+		--operations N		Operations over the whole run (default 1000000)
+		--months N			Month-ends, each followed by interest (default 1)
+		--zipf S			Zipf exponent for account popularity; 0 is uniform (default 0.99)
+		--mix D,W,L,O		Percent deposits, withdrawals, lookups and onboardings; they must
+							add up to 100 (default 60,25,10,5)
+		--replay FILE		Write the workload to FILE as batch commands instead of running it
+		--stats				After the run, print the bank's own instrumentation
+							(only collected in a BANK_INSTRUMENT build)
+
+	Latencies are measured around each call with steady_clock, so they include two clock reads.
+	Onboarded customers get new accounts, but only the population's accounts are picked for
+	deposits, withdrawals and lookups: which ids the new accounts get depends on thread timing.
+*/
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "Bank.h"
+#include "Instrumentation.h"
+
+namespace {
+
+enum class Op_Kind {Deposit, Withdrawal, Lookup, Onboard};
+
+const int OP_KINDS = 4;
+const char *const OP_NAMES[OP_KINDS] = {"deposit", "withdrawal", "lookup", "onboard"};
+
+/**
+	What to generate, from the command line
+*/
+struct Options
+{
+	uint64_t seed = 1;
+	int threads = 1;
+	int accounts = 100000;
+	int per_customer = 2;
+	uint64_t operations = 1000000;
+	int months = 1;
+	double zipf = 0.99;
+	int mix[OP_KINDS] = {60, 25, 10, 5};
+	std::string replay;			// Empty to run against a bank
+	bool stats = false;
+};
+
+/**
+	One generated operation
+*/
+struct Operation
+{
+	Op_Kind kind;
+	int account;				// Index in the population; for Onboard, the new customer's number
+	Money amt;					// For deposits and withdrawals
+};
+
+/**
+	Picks ranks 0..n-1 with probability proportional to 1 / (rank + 1)^s, by binary search
+	over the cumulative distribution
+*/
+class Zipf_Sampler
+{
+private:
+	std::vector<double> cdf;
+
+public:
+	Zipf_Sampler(int n, double s) : cdf((size_t)n)
+	{
+		double total = 0;
+		for (int k = 0; k < n; k++) {
+			total += std::pow((double)(k + 1), -s);
+			cdf[k] = total;
+		}
+		for (double &c : cdf)
+			c /= total;
+	}
+
+	/**
+	@param u A uniform draw in [0, 1)
+	@return the rank it picks
+	*/
+	int rank(double u) const
+	{
+		size_t k = std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+		return (int)std::min(k, cdf.size() - 1);
+	}
+};
+
+/**
+	The operations of one thread, in order.  Everything random is drawn from one stream, so
+	the operations depend only on the options and the thread number.
+*/
+class Op_Stream
+{
+private:
+	const Options &opts;
+	const Zipf_Sampler &zipf;
+	std::mt19937_64 rng;
+	uint64_t stride;			// Scatters ranks over the population; coprime with its size
+	int thread;
+	int onboarded = 0;
+
+	// A uniform draw in [0, 1) from the top 53 bits
+	double uniform() { return (double)(rng() >> 11) * (1.0 / 9007199254740992.0); }
+
+public:
+	Op_Stream(const Options &opts_, const Zipf_Sampler &zipf_, int thread_)
+		: opts(opts_), zipf(zipf_), thread(thread_)
+	{
+		std::seed_seq seq{(uint32_t)opts.seed, (uint32_t)(opts.seed >> 32), (uint32_t)thread};
+		rng.seed(seq);
+		stride = 2654435761u % (uint64_t)opts.accounts;
+		while (std::gcd(stride, (uint64_t)opts.accounts) != 1)
+			stride++;
+	}
+
+	Operation next()
+	{
+		Operation op;
+		int roll = (int)(rng() % 100);
+		int kind = 0;
+		while (kind < OP_KINDS - 1 && roll >= opts.mix[kind]) {
+			roll -= opts.mix[kind];
+			kind++;
+		}
+		op.kind = (Op_Kind)kind;
+		if (op.kind == Op_Kind::Onboard) {
+			op.account = onboarded++;
+			op.amt = Money::from_cents(0);
+		} else {
+			op.account = (int)((uint64_t)zipf.rank(uniform()) * stride % (uint64_t)opts.accounts);
+			// Deposits of $1 to $200, withdrawals of $1 to $100
+			op.amt = Money::from_cents(100 + (int64_t)(rng() % (op.kind == Op_Kind::Deposit ? 19901 : 9901)));
+		}
+		return op;
+	}
+
+	/**
+	@return the name of the n-th customer this thread onboards
+	*/
+	std::string onboard_name(int n) const
+	{
+		return "Load " + std::to_string(thread) + "-" + std::to_string(n);
+	}
+};
+
+int customers(const Options &opts)
+{
+	return (opts.accounts + opts.per_customer - 1) / opts.per_customer;
+}
+
+// The population: customer c owns accounts c, c + customers, c + 2 * customers, ...
+std::string customer_name(int c)
+{
+	return "Customer " + std::to_string(c);
+}
+
+const char *account_type(int i)
+{
+	return i % 2 ? "savings" : "checking";
+}
+
+const char *customer_tier(int i)
+{
+	return i % 3 == 0 ? "adult" : i % 3 == 1 ? "senior" : "student";
+}
+
+int customer_age(int i)
+{
+	return 18 + i % 70;
+}
+
+/**
+	Opening deposits, drawn from their own stream so they do not depend on the thread count
+*/
+std::mt19937_64 opening_stream(const Options &opts)
+{
+	std::seed_seq seq{(uint32_t)opts.seed, (uint32_t)(opts.seed >> 32), 0xFFFFFFFFu};
+	return std::mt19937_64(seq);
+}
+
+Money opening_deposit(std::mt19937_64 &rng)
+{
+	return Money::from_cents(50000 + (int64_t)(rng() % 500000));
+}
+
+// Operations thread t makes in month m, so that the months and threads add up to the total
+uint64_t share(const Options &opts, int month, int t)
+{
+	uint64_t parts = (uint64_t)opts.months * (uint64_t)opts.threads;
+	uint64_t part = (uint64_t)month * (uint64_t)opts.threads + (uint64_t)t;
+	return opts.operations / parts + (part < opts.operations % parts ? 1 : 0);
+}
+
+std::ostream &write_money(std::ostream &out, Money amt)
+{
+	int64_t cents = amt.get_cents();
+	return out << cents / 100 << '.' << (char)('0' + cents / 10 % 10) << (char)('0' + cents % 10);
+}
+
+/**
+	Write the workload as batch commands
+	@return the exit status
+*/
+int write_replay(const Options &opts, const Zipf_Sampler &zipf)
+{
+	std::ofstream out(opts.replay);
+	if (!out) {
+		std::cerr << "Cannot create " << opts.replay << '\n';
+		return 1;
+	}
+	out << "# load_generator --seed " << opts.seed << " --threads " << opts.threads
+		<< " --accounts " << opts.accounts << " --per-customer " << opts.per_customer
+		<< " --operations " << opts.operations << " --months " << opts.months
+		<< " --zipf " << opts.zipf << " --mix " << opts.mix[0] << ',' << opts.mix[1]
+		<< ',' << opts.mix[2] << ',' << opts.mix[3] << '\n';
+
+	int owners = customers(opts);
+	std::mt19937_64 opening = opening_stream(opts);
+	for (int i = 0; i < opts.accounts; i++) {
+		int c = i % owners;
+		out << "open|" << customer_name(c) << '|' << account_type(i);
+		if (i < owners)
+			out << "|1 Main St|555-0100|" << customer_age(c) << '|' << customer_tier(c);
+		out << "\ndeposit|" << 1001 + i << '|';
+		write_money(out, opening_deposit(opening)) << '\n';
+	}
+
+	std::vector<Op_Stream> streams;
+	for (int t = 0; t < opts.threads; t++)
+		streams.emplace_back(opts, zipf, t);
+	for (int m = 0; m < opts.months; m++) {
+		for (int t = 0; t < opts.threads; t++) {
+			for (uint64_t n = share(opts, m, t); n > 0; n--) {
+				Operation op = streams[t].next();
+				switch (op.kind) {
+				case Op_Kind::Deposit:
+				case Op_Kind::Withdrawal:
+					out << (op.kind == Op_Kind::Deposit ? "deposit|" : "withdraw|") << 1001 + op.account << '|';
+					write_money(out, op.amt) << '\n';
+					break;
+				case Op_Kind::Lookup:
+					out << "list|" << customer_name(op.account % owners) << '\n';
+					break;
+				case Op_Kind::Onboard:
+					out << "open|" << streams[t].onboard_name(op.account) << '|' << account_type(op.account)
+						<< "|1 Main St|555-0100|" << customer_age(op.account) << '|' << customer_tier(op.account) << '\n';
+					break;
+				}
+			}
+		}
+		out << "interest\n";
+	}
+	out.close();
+	if (!out) {
+		std::cerr << "Cannot write " << opts.replay << '\n';
+		return 1;
+	}
+	return 0;
+}
+
+/**
+	What one thread measured
+*/
+struct Thread_Results
+{
+	Latency_Histogram latency[OP_KINDS];
+};
+
+/**
+	Make one thread's share of a month's operations against the bank
+*/
+void run_thread(Bank &bank, const Options &opts, Op_Stream &stream, uint64_t count, Thread_Results &results)
+{
+	int owners = customers(opts);
+	std::string statement;
+	std::string name;
+	for (; count > 0; count--) {
+		Operation op = stream.next();
+		if (op.kind == Op_Kind::Lookup)
+			name = customer_name(op.account % owners);
+		else if (op.kind == Op_Kind::Onboard)
+			name = stream.onboard_name(op.account);
+		statement.clear();
+
+		auto start = std::chrono::steady_clock::now();
+		switch (op.kind) {
+		case Op_Kind::Deposit:
+			bank.make_deposit(1001 + op.account, op.amt);
+			break;
+		case Op_Kind::Withdrawal:
+			bank.make_withdrawal(1001 + op.account, op.amt);
+			break;
+		case Op_Kind::Lookup:
+			bank.render_statement(name, statement);
+			break;
+		case Op_Kind::Onboard:
+			bank.add_account(name, "1 Main St", "555-0100", customer_age(op.account),
+					customer_tier(op.account), account_type(op.account));
+			break;
+		}
+		auto elapsed = std::chrono::steady_clock::now() - start;
+		results.latency[(int)op.kind].record(
+				(uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+	}
+}
+
+void print_row(const char *name, const Latency_Histogram &h, double seconds)
+{
+	std::cout << std::left << std::setw(12) << name << std::right
+		<< std::setw(12) << h.count() << std::setw(14) << std::setprecision(0) << (seconds > 0 ? h.count() / seconds : 0.0)
+		<< std::setw(11) << h.mean() << std::setw(11) << h.percentile(0.50) << std::setw(11) << h.percentile(0.99)
+		<< std::setw(11) << h.percentile(0.999) << std::setw(11) << h.percentile(0.9999)
+		<< std::setw(13) << h.max() << '\n';
+}
+
+/**
+	Run the workload against a bank and report what it measured
+	@return the exit status
+*/
+int run_direct(const Options &opts, const Zipf_Sampler &zipf)
+{
+	using clock = std::chrono::steady_clock;
+	auto seconds_since = [](clock::time_point start) {
+		return std::chrono::duration<double>(clock::now() - start).count();
+	};
+
+	Bank bank(opts.threads > 1);
+	auto start = clock::now();
+	int owners = customers(opts);
+	std::mt19937_64 opening = opening_stream(opts);
+	for (int i = 0; i < opts.accounts; i++) {
+		int c = i % owners;
+		Account *acct = i < owners
+				? bank.add_account(customer_name(c), "1 Main St", "555-0100", customer_age(c), customer_tier(c), account_type(i))
+				: bank.add_account(customer_name(c), account_type(i));
+		bank.make_deposit(acct->get_account(), opening_deposit(opening));
+	}
+	std::cout << "Opened " << opts.accounts << " accounts for " << owners << " customers in "
+		<< std::fixed << std::setprecision(2) << seconds_since(start) << " s\n";
+
+	std::vector<Op_Stream> streams;
+	std::vector<std::unique_ptr<Thread_Results>> results;
+	for (int t = 0; t < opts.threads; t++) {
+		streams.emplace_back(opts, zipf, t);
+		results.emplace_back(new Thread_Results);
+	}
+	Latency_Histogram interest;
+	double op_seconds = 0;
+	for (int m = 0; m < opts.months; m++) {
+		start = clock::now();
+		std::vector<std::thread> workers;
+		for (int t = 1; t < opts.threads; t++)
+			workers.emplace_back(run_thread, std::ref(bank), std::cref(opts), std::ref(streams[t]),
+					share(opts, m, t), std::ref(*results[t]));
+		run_thread(bank, opts, streams[0], share(opts, m, 0), *results[0]);	// The main thread does its share too
+		for (std::thread &w : workers)
+			w.join();
+		op_seconds += seconds_since(start);
+
+		start = clock::now();
+		bank.accrue_interest((unsigned)opts.threads);
+		interest.record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count());
+	}
+
+	Latency_Histogram all;
+	Latency_Histogram kinds[OP_KINDS];
+	for (auto &r : results) {
+		for (int k = 0; k < OP_KINDS; k++) {
+			kinds[k].merge(r->latency[k]);
+			all.merge(r->latency[k]);
+		}
+	}
+
+	std::cout << all.count() << " operations on " << opts.threads << " thread" << (opts.threads == 1 ? "" : "s")
+		<< " in " << op_seconds << " s: " << std::setprecision(0) << all.count() / op_seconds << " ops/s\n\n";
+	std::cout << std::left << std::setw(12) << "operation" << std::right << std::setw(12) << "calls"
+		<< std::setw(14) << "per second" << std::setw(11) << "mean ns" << std::setw(11) << "p50"
+		<< std::setw(11) << "p99" << std::setw(11) << "p99.9" << std::setw(11) << "p99.99" << std::setw(13) << "max" << '\n';
+	for (int k = 0; k < OP_KINDS; k++) {
+		if (kinds[k].count())
+			print_row(OP_NAMES[k], kinds[k], op_seconds);
+	}
+	print_row("all", all, op_seconds);
+	std::cout << "\nInterest: " << interest.count() << " month-end run" << (interest.count() == 1 ? "" : "s")
+		<< ", mean " << std::setprecision(2) << interest.mean() / 1e6 << " ms, max " << interest.max() / 1e6 << " ms\n";
+	std::cout << "Total deposits: " << bank.total_deposits() << '\n';
+
+	if (opts.stats) {
+		std::cout << '\n';
+		bank.dump_instrumentation(std::cout);
+	}
+	return 0;
+}
+
+template <typename T>
+bool parse_number(std::string_view text, T &value)
+{
+	std::from_chars_result result = std::from_chars(text.data(), text.data() + text.size(), value);
+	return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+bool parse_mix(std::string_view text, int *mix)
+{
+	int total = 0;
+	for (int k = 0; k < OP_KINDS; k++) {
+		size_t comma = k < OP_KINDS - 1 ? text.find(',') : text.size();
+		if (comma == std::string_view::npos || !parse_number(text.substr(0, comma), mix[k]) || mix[k] < 0)
+			return false;
+		total += mix[k];
+		text.remove_prefix(std::min(comma + 1, text.size()));
+	}
+	return total == 100;
+}
+
+/**
+	Read the options
+	@return true if they were all understood
+*/
+bool parse_options(int argc, char *argv[], Options &opts)
+{
+	for (int i = 1; i < argc; i++) {
+		std::string_view arg = argv[i];
+		if (arg == "--stats") {
+			opts.stats = true;
+			continue;
+		}
+		if (i + 1 == argc)
+			return false;
+		std::string_view value = argv[++i];
+		bool ok;
+		if (arg == "--seed")
+			ok = parse_number(value, opts.seed);
+		else if (arg == "--threads")
+			ok = parse_number(value, opts.threads) && opts.threads > 0;
+		else if (arg == "--accounts")
+			ok = parse_number(value, opts.accounts) && opts.accounts > 0;
+		else if (arg == "--per-customer")
+			ok = parse_number(value, opts.per_customer) && opts.per_customer > 0;
+		else if (arg == "--operations")
+			ok = parse_number(value, opts.operations);
+		else if (arg == "--months")
+			ok = parse_number(value, opts.months) && opts.months > 0;
+		else if (arg == "--zipf")
+			ok = parse_number(value, opts.zipf) && opts.zipf >= 0;
+		else if (arg == "--mix")
+			ok = parse_mix(value, opts.mix);
+		else if (arg == "--replay")
+			ok = !(opts.replay = argv[i]).empty();
+		else
+			ok = false;
+		if (!ok)
+			return false;
+	}
+	return true;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+	Options opts;
+	if (!parse_options(argc, argv, opts)) {
+		std::cerr << "Usage: " << argv[0] << " [--seed N] [--threads N] [--accounts N] [--per-customer N]\n"
+			"\t[--operations N] [--months N] [--zipf S] [--mix D,W,L,O] [--replay FILE] [--stats]\n";
+		return 1;
+	}
+
+	Zipf_Sampler zipf(opts.accounts, opts.zipf);
+	if (!opts.replay.empty())
+		return write_replay(opts, zipf);
+	std::ios::sync_with_stdio(false);
+	return run_direct(opts, zipf);
+}